@@ -1,4 +1,5 @@
 #include "jc_type.h"
+#include "jc_writer.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -15,6 +16,11 @@
 #define HIGHLIGHT "\033[1m"
 #define NONE "\033[0m"
 
+static int write_stdout(void *ctx, const char *data, size_t len)
+{
+    return fwrite(data, 1, len, (FILE *)ctx) == len ? 0 : -1;
+}
+
 int main(int argc, char *argv[])
 {
     int         i;
@@ -76,12 +82,14 @@ int main(int argc, char *argv[])
     printf("%s\n", jc_json_str(js2));
     jc_json_destroy(js2);
 
+    /* the string of jc_json_str() lives as long as its json */
+    jc_json_t *js3;
     js2 = jc_json_parse(s);
     const char *js2_str = jc_json_str(js2);
-    jc_json_destroy(js2);
 
-    js2 = jc_json_parse(js2_str);
-    printf("%s\n", jc_json_str(js2));
+    js3 = jc_json_parse(js2_str);
+    printf("%s\n", jc_json_str(js3));
+    jc_json_destroy(js3);
     jc_json_destroy(js2);
 
     printf("===============>\n");
@@ -95,6 +103,42 @@ int main(int argc, char *argv[])
     printf("%s\n", jc_json_str(num_js));
     jc_json_destroy(num_js);
 
+    /* write json without building a jc_json_t */
+    char         wbuf[64];
+    jc_buf_t     out;
+    jc_writer_t  w;
+
+    jc_buf_init_flush(&out, wbuf, sizeof(wbuf), write_stdout, stdout);
+    jc_writer_init(&w, &out);
+    jc_writer_begin_object(&w);
+    jc_writer_key(&w, "level", 5);
+    jc_writer_str(&w, "info", 4);
+    jc_writer_key(&w, "ts", 2);
+    jc_writer_int(&w, 1466736000123LL);
+    jc_writer_key(&w, "latency", 7);
+    jc_writer_num(&w, 0.125);
+    jc_writer_end_object(&w);
+    jc_buf_flush(&out);
+    printf("\n");
+
+    /* parse a message as it arrives, in chunks split anywhere */
+    const char  *msg = "{\"user\":\"\\u5f20\\u4e09\",\"tags\":[\"a\",\"b\"],\"id\":1024}";
+    size_t       off, chunk = 5;
+    jc_parser_t *parser = jc_parser_create();
+
+    for (off = 0; off < strlen(msg); off += chunk) {
+        size_t n = strlen(msg) - off < chunk ? strlen(msg) - off : chunk;
+        if (jc_parser_feed(parser, msg + off, n) != 0) {
+            break;
+        }
+    }
+    jc_json_t *fed = jc_parser_finish(parser);
+    if (fed) {
+        printf("%s\n", jc_json_str(fed));
+    }
+    jc_json_destroy(fed);
+    jc_parser_destroy(parser);
+
     return 0;
 }
 
@@ -20,13 +20,33 @@ typedef unsigned long size_t;
 
 typedef struct jc_pool_data_s  jc_pool_data_t;
 typedef struct jc_pool_large_s jc_pool_large_t;
+#ifndef __JC_POOL_T__
+#define __JC_POOL_T__
 typedef struct jc_pool_s       jc_pool_t;
+#endif
+
+typedef struct jc_pool_cleanup_s jc_pool_cleanup_t;
 
 typedef void (*jc_pool_cln_t)(void *);
 
+/* run by jc_pool_destroy(), the last added first */
+struct jc_pool_cleanup_s {
+    jc_pool_cln_t        handler;
+    void                *data;
+    jc_pool_cleanup_t   *next;
+};
+
 jc_pool_t *jc_pool_create(size_t  size);
 void jc_pool_destroy(jc_pool_t *pool);
+/* run the cleanups, free the large chunks and rewind every block,
+ * which are kept for the next use of the pool */
+void jc_pool_reset(jc_pool_t *pool);
 void *jc_pool_alloc(jc_pool_t *pool, size_t size);
+void *jc_pool_realloc(jc_pool_t *pool, void *m, size_t old_size,
+        size_t new_size);
+/* give m, got from jc_pool_alloc(pool, size), back for reuse */
+void jc_pool_free(jc_pool_t *pool, void *m, size_t size);
+jc_pool_cleanup_t *jc_pool_cleanup_add(jc_pool_t *pool);
 
 #endif
 
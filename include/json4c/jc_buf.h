@@ -0,0 +1,70 @@
+#ifndef __JC_BUF_H__
+#define __JC_BUF_H__
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/*
+ * Output buffer of the serializer.
+ *
+ * A growable buffer is malloc-ed and grows as needed.
+ * A fixed buffer is supplied by the caller and never grows: when it is
+ * full the writer returns JC_BUF_FULL, the caller consumes data[0, len),
+ * calls jc_buf_drain() and calls the writer again with the same
+ * arguments, which resumes where the last call stopped.
+ * A flushing buffer is a fixed buffer which hands its content to a
+ * callback whenever it is full, so it is never full for the writer.
+ * */
+
+#define JC_BUF_FULL (-2)
+
+typedef struct jc_buf_s jc_buf_t;
+
+/* return 0 if all of data has been taken */
+typedef int (*jc_buf_flush_pt)(void *ctx, const char *data, size_t len);
+
+struct jc_buf_s {
+    char     *data;
+    size_t    len;      /* bytes in data */
+    size_t    cap;      /* size of data */
+    int       fixed;    /* data belongs to the caller */
+    size_t    pos;      /* bytes produced by the running write */
+    size_t    done;     /* bytes taken by previous calls, skipped on resume */
+    int       cut;      /* the last write stopped with JC_BUF_FULL */
+
+    jc_buf_flush_pt   flush;
+    void             *ctx;
+};
+
+void jc_buf_init(jc_buf_t *b);
+void jc_buf_init_fixed(jc_buf_t *b, char *mem, size_t size);
+void jc_buf_init_flush(jc_buf_t *b, char *mem, size_t size,
+        jc_buf_flush_pt flush, void *ctx);
+void jc_buf_free(jc_buf_t *b);
+
+/* drop the content and any interrupted write */
+void jc_buf_reset(jc_buf_t *b);
+/* the content has been consumed, an interrupted write may resume */
+void jc_buf_drain(jc_buf_t *b);
+/* hand the content of a flushing buffer to its callback */
+int jc_buf_flush(jc_buf_t *b);
+
+/* put functions return 0, -1 if out of memory or JC_BUF_FULL */
+int jc_buf_put(jc_buf_t *b, const char *s, size_t n);
+/* s as a quoted and escaped json string */
+int jc_buf_put_str(jc_buf_t *b, const char *s, size_t n);
+int jc_buf_put_num(jc_buf_t *b, double d);
+int jc_buf_put_int(jc_buf_t *b, int64_t i);
+
+static inline int jc_buf_putc(jc_buf_t *b, char ch)
+{
+    if (b->pos == b->done && b->len != b->cap) {
+        b->data[b->len++] = ch;
+        b->pos++;
+        b->done++;
+        return 0;
+    }
+    return jc_buf_put(b, &ch, 1);
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __JC_INTERN_H__
+#define __JC_INTERN_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A dictionary of keys shared by documents, see jc_json_set_intern().
+ * Every key parsed or added to such a document is looked up here and,
+ * if found, the one shared copy is used instead of a copy in the pool
+ * of the document. Keys are added on first sight until max of them are
+ * known; later ones are copied as usual. Lookups take no lock at all,
+ * so one dictionary may serve documents of many threads.
+ * */
+
+#include <stdint.h>
+
+#include "jc_type.h"
+
+#define JC_INTERN_MAX  65536
+
+/* at most max keys, JC_INTERN_MAX if 0 */
+jc_intern_t *jc_intern_create(size_t max);
+/* the dictionary is freed when its last document goes */
+void jc_intern_destroy(jc_intern_t *dict);
+
+/* the shared copy of key, added if there is room, or NULL;
+ * hash is jc_intern_hash(key, len) */
+jc_key_t *jc_intern_get(jc_intern_t *dict, const char *key, size_t len,
+        uint32_t hash);
+/* the same, without adding */
+jc_key_t *jc_intern_find(jc_intern_t *dict, const char *key, size_t len,
+        uint32_t hash);
+uint32_t jc_intern_hash(const char *key, size_t len);
+
+/* count one more user of dict */
+jc_intern_t *jc_intern_ref(jc_intern_t *dict);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef __JC_LINES_H__
+#define __JC_LINES_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Newline delimited json parsed by several threads. The input, a whole
+ * file mapped in memory say, is cut into chunks at newlines, and every
+ * worker takes the next chunk, parses its records in a pool of its own
+ * and hands them to the callback, see jc_json_parse_lines(). A record
+ * must therefore fit on one line.
+ *
+ * In order, the callback is called by one worker at a time, the records
+ * of a chunk being kept until those of the chunks before are handled.
+ * Out of order, it is called by all the workers at once, and must be
+ * safe for that.
+ * */
+
+#include "jc_type.h"
+
+#define JC_LINES_CHUNK  (1 << 20)
+
+/* a field left 0 takes its default */
+typedef struct {
+    int       threads;    /* workers, the caller among them; one a cpu */
+    size_t    chunk;      /* bytes taken at once; JC_LINES_CHUNK */
+    int       ordered;    /* hand the records over in the order of buf */
+    int       flags;      /* JC_JSON_* of the records */
+} jc_lines_conf_t;
+
+/*
+ * parse the records of buf with conf, the defaults if NULL; return the
+ * records, or -1 if one is bad or each returned non-zero. used, if not
+ * NULL, is then set to the bytes before the first record not handled:
+ * in order, every record before it was; out of order, records after it
+ * may have been too.
+ * */
+ssize_t jc_lines_parse(const char *buf, size_t len,
+        const jc_lines_conf_t *conf, size_t *used,
+        jc_json_each_t each, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
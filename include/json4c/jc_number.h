@@ -0,0 +1,32 @@
+#ifndef __JC_NUMBER_H__
+#define __JC_NUMBER_H__
+
+#include <sys/types.h>
+#include <stdint.h>
+
+typedef struct {
+    int       is_int;   /* integral literal which fits in int64_t */
+    int64_t   i;
+    double    d;
+} jc_number_t;
+
+/*
+ * parse the json number at [p, end) into num,
+ * return the bytes consumed or -1 if it is not a valid number.
+ * Doubles are correctly rounded (Eisel-Lemire, falls back to
+ * strtod for the rare inputs it cannot decide).
+ * */
+ssize_t jc_number_parse(const char *p, const char *end, jc_number_t *num);
+
+/* max bytes written by jc_number_dtoa() and jc_number_itoa() */
+#define JC_NUMBER_MAXLEN 32
+
+/*
+ * write the shortest decimal form of d which reads back to d
+ * (Grisu2), without a terminating zero, return the bytes written.
+ * NaN and infinities are written as null.
+ * */
+int jc_number_dtoa(double d, char *buf);
+int jc_number_itoa(int64_t i, char *buf);
+
+#endif
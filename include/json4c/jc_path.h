@@ -0,0 +1,46 @@
+#ifndef __JC_PATH_H__
+#define __JC_PATH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A compiled set of key paths, for jc_json_parse_path(): only the values
+ * they name are built, everything else is skipped.
+ *
+ *     const char *paths[] = { "user.id", "items[*].sku", "meta.ts" };
+ *     jc_path_t  *path = jc_path_create(paths, 3);
+ *
+ * Keys are separated by '.', "[*]" stands for every element of an array.
+ * A key holding '.' or '[' cannot be named. The paths form a tree, one
+ * node for each key or "[*]"; it never changes once compiled, so one may
+ * serve the parsers of many threads.
+ * */
+
+#include <stddef.h>
+
+#include "jc_type.h"
+
+struct jc_path_s {
+    const char   *key;      /* of a member, NULL for the elements */
+    size_t        len;
+    int           all;      /* the whole value is kept */
+    jc_path_t    *child;    /* first of the nodes inside the value */
+    jc_path_t    *next;     /* the next child of the parent */
+    jc_pool_t    *pool;     /* of the tree, in the root only */
+};
+
+/* NULL if out of memory or a path is bad */
+jc_path_t *jc_path_create(const char *const *paths, size_t n);
+void jc_path_destroy(jc_path_t *path);
+
+/* the child of node for the member key of len bytes, or for the
+ * elements if key is NULL; NULL if there is none */
+jc_path_t *jc_path_find(jc_path_t *node, const char *key, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
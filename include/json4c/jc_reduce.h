@@ -0,0 +1,23 @@
+#ifndef __JC_REDUCE_H__
+#define __JC_REDUCE_H__
+
+/*
+ * Reductions over packed numbers, used by the numeric arrays.
+ * They take 4 (AVX2) or 2 (SSE2) numbers per step, in several lanes, so
+ * a sum of doubles may round differently from a loop in order.
+ * The min and max of nothing are undefined, n must not be 0.
+ * */
+
+#include <stddef.h>
+#include <stdint.h>
+
+double jc_sum_f64(const double *x, size_t n);
+double jc_min_f64(const double *x, size_t n);
+double jc_max_f64(const double *x, size_t n);
+
+/* the sum wraps around if it does not fit */
+int64_t jc_sum_i64(const int64_t *x, size_t n);
+int64_t jc_min_i64(const int64_t *x, size_t n);
+int64_t jc_max_i64(const int64_t *x, size_t n);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef __JC_SAX_H__
+#define __JC_SAX_H__
+
+/*
+ * Event (SAX) parser: reports what it reads through callbacks instead
+ * of building a jc_json_t.
+ *
+ * Strings without escapes are passed as pointers into the input,
+ * escaped ones are decoded into a buffer reused by the whole parse;
+ * neither is NUL-terminated and both are valid only during the call.
+ * Any callback may be NULL. A callback returning non-zero stops the
+ * parse, which then fails.
+ * */
+
+#include <sys/types.h>
+#include <stdint.h>
+
+typedef struct jc_sax_s jc_sax_t;
+typedef struct jc_sax_parser_s jc_sax_parser_t;
+
+struct jc_sax_s {
+    int (*start_object)(void *ctx);
+    int (*end_object)(void *ctx);
+    int (*start_array)(void *ctx);
+    int (*end_array)(void *ctx);
+    int (*key)(void *ctx, const char *key, size_t len);
+    int (*string)(void *ctx, const char *s, size_t len);
+    int (*number)(void *ctx, double n);
+    int (*integer)(void *ctx, int64_t i);
+    int (*boolean)(void *ctx, int b);
+    int (*null)(void *ctx);
+};
+
+/* max nesting of objects and arrays */
+#define JC_SAX_MAXDEPTH 1024
+#define JC_SAX_SCRATCH  256
+
+/*
+ * State of a parse that is fed in chunks. Everything needed to go on
+ * lives here: the open containers, one byte each, and the bytes of a
+ * token cut by the end of a chunk.
+ * */
+struct jc_sax_parser_s {
+    const jc_sax_t  *sax;
+    void            *ctx;
+    int              depth;
+    int              started;
+    int              done;
+    int              last;      /* no more input after this chunk */
+    char            *pend;      /* token cut by the end of a chunk */
+    size_t           plen;
+    size_t           pcap;
+    char            *scratch;   /* decoded escaped strings */
+    size_t           cap;
+    unsigned char    stack[JC_SAX_MAXDEPTH];
+    char             small[JC_SAX_SCRATCH];
+};
+
+/*
+ * parse the json value in [buf, buf + len), return the bytes consumed,
+ * including the whitespace following it, or -1
+ * */
+ssize_t jc_sax_parse(const char *buf, size_t len, const jc_sax_t *sax,
+        void *ctx);
+
+/*
+ * chunked parse: jc_sax_feed() may be called with any split of the
+ * input and returns 0 or -1, jc_sax_finish() returns 0 if a whole
+ * value was read. jc_sax_free() releases the buffers in any case.
+ * */
+void jc_sax_init(jc_sax_parser_t *sp, const jc_sax_t *sax, void *ctx);
+int jc_sax_feed(jc_sax_parser_t *sp, const char *buf, size_t len);
+int jc_sax_finish(jc_sax_parser_t *sp);
+void jc_sax_free(jc_sax_parser_t *sp);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef __JC_SCAN_H__
+#define __JC_SCAN_H__
+
+/*
+ * Byte classifiers for the parser.
+ * They look at 16 (SSE2) or 32 (AVX2) bytes per step, and 8 bytes
+ * per step (SWAR) on targets without vector units.
+ * All of them stop at `end' and never read past it.
+ * */
+
+#include <stddef.h>
+
+/* return the first byte in [p, end) which is not json whitespace */
+const char *jc_scan_ws(const char *p, const char *end);
+
+/* return the first '"' or '\\' in [p, end), or end */
+const char *jc_scan_str(const char *p, const char *end);
+
+/* return the byte past the bracket closing the '{' or '[' at p, or NULL
+ * if it is not closed before end; strings are skipped, brackets are only
+ * counted, so the text in between is not checked at all */
+const char *jc_scan_skip(const char *p, const char *end);
+
+#endif
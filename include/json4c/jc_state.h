@@ -0,0 +1,25 @@
+#ifndef __JC_STATE_H__
+#define __JC_STATE_H__
+
+/*
+ * States of the json parsers, shared by the tree parser (jc_type.c)
+ * and the event parser (jc_sax.c). For detail, see http://www.json.org
+ * */
+
+typedef enum {
+    JC_OBJ_START = 0,
+    JC_OBJ_LBRACE,
+    JC_OBJ_KEY,
+    JC_OBJ_VAL,
+    JC_OBJ_COLON,
+    JC_OBJ_COMMA,
+} jc_obj_state_t;
+
+typedef enum {
+    JC_ARR_START = 0,
+    JC_ARR_VAL,
+    JC_ARR_COMMA,
+    JC_ARR_END
+} jc_arr_state_t;
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef __JC_STR_H__
+#define __JC_STR_H__
+
+/*
+ * Layout of jc_str_t, shared by the documents (jc_type.c) and the key
+ * dictionary (jc_intern.c). Not a public header.
+ * */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "jc_type.h"
+
+struct jc_str_s {
+    size_t   size;     /* size of str */
+    size_t   free;     /* free space, JC_STR_INTERNED for a shared key */
+    char     body[];   /* str */
+};
+
+/*
+ * A key of a jc_intern_t: one copy for every document attached to the
+ * dictionary, so that two of them are the same key if and only if they
+ * are the same pointer. Its hash is kept in the word before it.
+ * */
+#define JC_STR_INTERNED     ((size_t)-1)
+#define jc_str_interned(s)  ((s)->free == JC_STR_INTERNED)
+#define jc_str_hash(s)      (*(const uint32_t *)((const char *)(s) - 8))
+
+static inline uint32_t jc_hash(const char *key, size_t len)
+{
+    size_t    i;
+    uint32_t  h;
+
+    /* FNV-1a */
+    for (h = 2166136261u, i = 0; i != len; ++i) {
+        h = (h ^ (unsigned char)key[i]) * 16777619u;
+    }
+    return h;
+}
+
+/* the hash of any key, interned or not */
+static inline uint32_t jc_key_hash(const jc_key_t *k)
+{
+    return jc_str_interned(k) ? jc_str_hash(k)
+        : jc_hash(k->body, k->size - 1);
+}
+
+#endif
@@ -8,11 +8,22 @@ extern "C" {
 #include <sys/types.h>
 #include <stdint.h>
 
+#include "jc_buf.h"
+
 typedef short                jc_bool_t;
 typedef double               jc_num_t;
+typedef int64_t              jc_int_t;
 typedef struct jc_str_s      jc_str_t;
 typedef struct jc_array_s    jc_array_t;
 typedef struct jc_json_s     jc_json_t;
+typedef struct jc_parser_s   jc_parser_t;
+typedef struct jc_intern_s   jc_intern_t;
+typedef struct jc_path_s     jc_path_t;
+/* jc_alloc.h declares it too, and is not needed here */
+#ifndef __JC_POOL_T__
+#define __JC_POOL_T__
+typedef struct jc_pool_s     jc_pool_t;
+#endif
 
 typedef struct jc_str_s      jc_key_t;
 typedef struct jc_val_s      jc_val_t;
@@ -23,35 +34,153 @@ typedef enum __jc_type_t {
     JC_STR,
     JC_ARRAY,
     JC_JSON,
-    JC_NULL
+    JC_NULL,
+    JC_INT              /* integral number which fits in 64 bits */
 } jc_type_t;
 
+/*
+ * 16 bytes, stored inline in objects and arrays. A string of at most
+ * JC_STR_INLINE bytes is kept in the value itself: its bytes start at
+ * data and go on in ext, and len holds JC_STR_INLINE - length, so the
+ * longest one is terminated by len itself. Longer strings are in data.s
+ * and len is JC_STR_HEAP, or, with JC_JSON_VIEW, in the parsed buffer
+ * at data.v, their length in ext, and len is JC_STR_VIEW. Use
+ * jc_val_str() rather than these fields. An object or array not parsed
+ * yet, with JC_JSON_LAZY, is its text at data.v, the length in ext, and
+ * len is JC_VAL_LAZY.
+ * */
+#define JC_STR_INLINE  14
+#define JC_STR_HEAP    0xff
+#define JC_STR_VIEW    0xfe
+#define JC_VAL_LAZY    0xfd
+
 struct jc_val_s {
-    jc_type_t         type;
     union {
         jc_bool_t     b;
         jc_num_t      n;
+        jc_int_t      i;
         jc_str_t     *s;
+        const char   *v;
         jc_array_t   *a;
         jc_json_t    *j;
     } data;
+    char              ext[6];
+    unsigned char     len;
+    unsigned char     type;    /* jc_type_t */
 };
 
-/* json create and delete functions */
+/* keep keys in the order they are added or parsed, instead of sorted */
+#define JC_JSON_ORDERED  0x01
+/* strings without escapes are not copied but point into the parsed
+ * buffer, which must then outlive the document; jc_val_str() of such
+ * a string is not NUL-terminated */
+#define JC_JSON_VIEW     0x02
+/* nested objects and arrays are only skipped by the parse, and parsed
+ * one level at a time when jc_json_find(), jc_json_get_val() or
+ * jc_array_get() first reach them; the buffer must outlive the document,
+ * errors in the parts never reached go unnoticed, and even these lookups
+ * change the document, so it may not be shared by threads */
+#define JC_JSON_LAZY     0x04
+
+/*
+ * json create and delete functions,
+ * any json value may be parsed: an object is the document itself, any
+ * other value is the top of a document without keys, see jc_json_value()
+ * */
 jc_json_t *jc_json_create();
+/* flags are JC_JSON_*, they apply to every object of the document */
+jc_json_t *jc_json_create_ex(int flags);
+/* only whitespace may follow the value */
 jc_json_t *jc_json_parse(const char *json_str);
+/* parse at most len bytes of buf, which need not be NUL-terminated;
+ * if used is not NULL, it is set to the bytes consumed, including
+ * the whitespace following the value, and anything may follow them;
+ * if used is NULL, only whitespace may follow the value. The same holds
+ * for every parse function taking used */
+jc_json_t *jc_json_parse_n(const char *buf, size_t len, size_t *used);
+jc_json_t *jc_json_parse_ex(const char *buf, size_t len, size_t *used,
+        int flags);
+/* build only the values named by path, see jc_path.h; the rest is
+ * skipped without a copy and, but for its brackets, not checked */
+jc_json_t *jc_json_parse_path(const char *buf, size_t len, size_t *used,
+        jc_path_t *path);
 void jc_json_destroy(jc_json_t *js);
 
-/* json add kv functions */
+/*
+ * the same in a pool of the caller, made by jc_pool_create() of
+ * jc_alloc.h: nothing is freed by jc_json_destroy(), the json lives
+ * until jc_pool_reset(pool) or jc_pool_destroy(pool), so one warm pool
+ * can serve every message
+ * */
+jc_json_t *jc_json_create_in(jc_pool_t *pool);
+jc_json_t *jc_json_parse_into(jc_pool_t *pool, const char *buf, size_t len,
+        size_t *used);
+jc_json_t *jc_json_parse_into_ex(jc_pool_t *pool, const char *buf,
+        size_t len, size_t *used, int flags);
+
+/*
+ * share the keys of js with the other documents of dict, see jc_intern.h;
+ * js must be an empty document, fill it by jc_json_parse_to() or the
+ * jc_json_add_*() functions. Return 0 or -1
+ * */
+int jc_json_set_intern(jc_json_t *js, jc_intern_t *dict);
+/* parse buf into the empty document js, return 0 or -1 */
+int jc_json_parse_to(jc_json_t *js, const char *buf, size_t len,
+        size_t *used);
+
+/*
+ * Newline delimited json: the records of buf, values apart by some
+ * whitespace, are parsed one by one into pool with flags JC_JSON_*,
+ * and each one is handed to each, to live until it returns 0 to go on.
+ * pool is reset after every record. A record reaching the end of buf,
+ * with no whitespace after it, may go on in bytes yet to come: it is
+ * left pending, not handed over. Return the records handed over, or -1
+ * if one is bad or each returned non-zero; used, if not NULL, is set to
+ * the bytes of the records done, so a pending record starts there
+ * */
+typedef int (*jc_json_each_t)(void *ctx, jc_json_t *js);
+
+ssize_t jc_json_parse_lines(jc_pool_t *pool, const char *buf, size_t len,
+        int flags, size_t *used, jc_json_each_t each, void *ctx);
+
+/* incremental parse: the value may be fed in chunks split anywhere,
+ * jc_parser_finish() hands the completed document over to the caller,
+ * or returns NULL if the input was bad or is not complete yet */
+jc_parser_t *jc_parser_create();
+int jc_parser_feed(jc_parser_t *parser, const char *buf, size_t len);
+jc_json_t *jc_parser_finish(jc_parser_t *parser);
+void jc_parser_destroy(jc_parser_t *parser);
+
+/* json add kv functions,
+ * the values of a key added or parsed again are gathered in an array;
+ * a document which is not an object takes no keys, nor can it be added */
 int jc_json_add_bool(jc_json_t *js, const char *key, int bool_val);
 int jc_json_add_num(jc_json_t *js, const char *key, double val);
+int jc_json_add_int(jc_json_t *js, const char *key, int64_t val);
 int jc_json_add_str(jc_json_t *js, const char *key, const char *val);
 int jc_json_add_array(jc_json_t *js, const char *key);
 int jc_json_add_json(jc_json_t *js, const char *key, jc_json_t *sub_js);
 int jc_json_add_null(jc_json_t *js, const char *key);
 
-/* json find function */
+/* json find function,
+ * values live inside their object or array: a jc_val_t pointer is valid
+ * until a value is added to the container holding it;
+ * NULL if key is missing, or, with JC_JSON_LAZY, its value is bad */
 jc_val_t *jc_json_find(jc_json_t *js, const char *key);
+/* the value parsed at the top of js, or js itself as a JC_JSON value */
+jc_val_t *jc_json_value(jc_json_t *js);
+
+/* json value function */
+jc_type_t jc_val_type(jc_val_t *val);
+int jc_val_bool(jc_val_t *val);
+/* JC_NUM, or JC_INT converted to double */
+double jc_val_num(jc_val_t *val);
+/* JC_INT, or JC_NUM truncated */
+int64_t jc_val_int(jc_val_t *val);
+/* the bytes of a string and their number, if len is not NULL */
+const char *jc_val_str(jc_val_t *val, size_t *len);
+jc_array_t *jc_val_array(jc_val_t *val);
+jc_json_t *jc_val_json(jc_val_t *val);
 
 /* json str function */
 size_t jc_str_size(jc_str_t *s);
@@ -60,15 +189,38 @@ const char *jc_str_body(jc_str_t *s);
 /* json array function */
 size_t jc_array_size(jc_array_t *jarray);
 jc_val_t *jc_array_get(jc_array_t *jarray, size_t idx);
+/* make room for n values in all, return 0 or -1 */
+int jc_array_reserve(jc_array_t *jarray, size_t n);
+
+/*
+ * Arrays of numbers are stored packed: the numbers of an array of JC_INT
+ * only, or of JC_NUM only (integers which are exact in a double are
+ * taken as JC_NUM there), or NULL for any other array. Valid until
+ * a value is added to the array.
+ * */
+const double *jc_array_data_f64(jc_array_t *jarray);
+const int64_t *jc_array_data_i64(jc_array_t *jarray);
+/* aggregates of an array of numbers, packed or not, return 0 or -1 if
+ * it holds other values or, but for the sum, is empty; a sum of JC_INT
+ * wraps around if it does not fit */
+int jc_array_sum(jc_array_t *jarray, double *sum);
+int jc_array_min(jc_array_t *jarray, double *min);
+int jc_array_max(jc_array_t *jarray, double *max);
+int jc_array_mean(jc_array_t *jarray, double *mean);
 
 /* json obj function */
 size_t jc_json_size(jc_json_t *js);
 jc_str_t *jc_json_get_key(jc_json_t *js, size_t idx);
 jc_val_t *jc_json_get_val(jc_json_t *js, size_t idx);
+/* make room for n keys in all, return 0 or -1 */
+int jc_json_reserve(jc_json_t *js, size_t n);
 
-/* json to string function */
+/* json to string function,
+ * the string is valid until the next call on js or jc_json_destroy() */
 const char *jc_json_str(jc_json_t *js);
 const char *jc_json_str_n(jc_json_t *js, size_t *len);
+/* append js to out in one pass, return 0, -1 or JC_BUF_FULL */
+int jc_json_write(jc_json_t *js, jc_buf_t *out);
 
 #ifdef __cplusplus
 }
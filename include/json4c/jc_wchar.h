@@ -1,4 +1,20 @@
-#include <stdlib.h>
-#include <locale.h>
+#ifndef __JC_WCHAR_H__
+#define __JC_WCHAR_H__
 
-int jc_wctomb(const char *unicode, char *chs);
+#include <stddef.h>
+#include <stdint.h>
+
+/* max bytes jc_unescape() writes for one escape sequence */
+#define JC_UNESCAPE_MAX 4
+
+/* encode code point cp as UTF-8 into out, return the bytes written or -1 */
+int jc_utf8_encode(uint32_t cp, char *out);
+
+/*
+ * decode the escape sequence at p (p[0] == '\\') into out,
+ * return the bytes written or -1, *used is set to the bytes consumed.
+ * A '\uXXXX' escape is written as UTF-8, surrogate pairs included.
+ * */
+int jc_unescape(const char *p, const char *end, char *out, size_t *used);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef __JC_WRITER_H__
+#define __JC_WRITER_H__
+
+/*
+ * Streaming json writer: emits json straight into a jc_buf_t,
+ * without building a jc_json_t first.
+ *
+ *     jc_writer_begin_object(w);
+ *     jc_writer_key(w, "id", 2);
+ *     jc_writer_int(w, 42);
+ *     jc_writer_end_object(w);
+ *
+ * Top-level values are separated by '\n', one record per line.
+ * The buffer should be growable or flushing: a fixed buffer which
+ * fills up leaves the output cut short.
+ * All functions return 0, or -1 if out of memory, the callback
+ * failed or the call does not fit where the writer is.
+ * */
+
+#include "jc_buf.h"
+
+#define JC_WRITER_MAXDEPTH 128
+
+typedef struct jc_writer_s jc_writer_t;
+
+struct jc_writer_s {
+    jc_buf_t       *out;
+    size_t          count;      /* top-level values written */
+    int             depth;
+    unsigned char   stack[JC_WRITER_MAXDEPTH];
+};
+
+void jc_writer_init(jc_writer_t *w, jc_buf_t *out);
+
+int jc_writer_begin_object(jc_writer_t *w);
+int jc_writer_end_object(jc_writer_t *w);
+int jc_writer_begin_array(jc_writer_t *w);
+int jc_writer_end_array(jc_writer_t *w);
+
+int jc_writer_key(jc_writer_t *w, const char *key, size_t len);
+
+int jc_writer_str(jc_writer_t *w, const char *s, size_t len);
+int jc_writer_num(jc_writer_t *w, double n);
+int jc_writer_int(jc_writer_t *w, int64_t i);
+int jc_writer_bool(jc_writer_t *w, int b);
+int jc_writer_null(jc_writer_t *w);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef __JC_CONFIG_H__
+#define __JC_CONFIG_H__
+
+#define HAVE_MALLOC_H
+#define HAVE_STDLIB_H
+#define HAVE_SYS_TYPES_H
+
+#endif
@@ -7,10 +7,20 @@
 #endif
 
 #include <unistd.h>
+#include <string.h>
 #include <assert.h>
+#include <pthread.h>
 
 #define JC_POOLMINSIZE 1024
 
+/*
+ * Chunks given back by jc_pool_free() are kept on free lists by size
+ * class: class i holds chunks of [2^(i+3), 2^(i+4)) bytes, and the
+ * last class everything bigger. An allocation is served from the first
+ * class whose chunks are all big enough, before the blocks are tried.
+ * */
+#define JC_POOL_CLASSES 10
+
 struct jc_pool_data_s {
     char        *last;      /* last position of alloced data */
     char        *end;       /* end of current pool */
@@ -29,10 +39,13 @@ struct jc_pool_s {
     size_t              max;     /* max data can alloc from pool */
     jc_pool_t          *current;
     jc_pool_large_t    *large;
-    jc_pool_cln_t       cln;
+    jc_pool_cleanup_t  *cleanup;
+    unsigned            freemask;   /* classes with free chunks */
+    void               *free[JC_POOL_CLASSES];
 };
 
-static int jc_initialized = 0;
+/* set once, by whichever thread creates the first pool */
+static pthread_once_t jc_initialized = PTHREAD_ONCE_INIT;
 static size_t jc_pagesize;
 
 #ifdef HAVE_MALLOC_H
@@ -51,12 +64,14 @@ static void *jc_memalign(size_t boundary, size_t size)
 }
 #endif
 
+static void jc_init_once()
+{
+    jc_pagesize = (size_t)getpagesize();
+}
+
 static void jc_init()
 {
-    if (jc_initialized == 0) {
-        jc_pagesize = (size_t)getpagesize();
-        jc_initialized = 1;
-    }
+    pthread_once(&jc_initialized, jc_init_once);
 }
 
 jc_pool_t *jc_pool_create(size_t size)
@@ -83,26 +98,38 @@ jc_pool_t *jc_pool_create(size_t size)
 
     p->current = p;
     p->large = NULL;
-    p->cln = NULL;
+    p->cleanup = NULL;
+    p->freemask = 0;
+    memset(p->free, 0, sizeof(p->free));
 
     return p;
 }
 
-void jc_pool_destroy(jc_pool_t *p)
+static void jc_pool_release(jc_pool_t *p)
 {
-    jc_pool_large_t  *large;
-    jc_pool_t        *cur;
-
-    assert(p != NULL);
+    jc_pool_large_t    *large;
+    jc_pool_cleanup_t  *c;
 
-    if (p->cln) {
-        p->cln(p);
+    for (c = p->cleanup; c != NULL; c = c->next) {
+        if (c->handler) {
+            c->handler(c->data);
+        }
     }
     for (large = p->large; large != NULL; large = large->next) {
         if (large->ptr) {
             free(large->ptr);
         }
     }
+}
+
+void jc_pool_destroy(jc_pool_t *p)
+{
+    jc_pool_t  *cur;
+
+    assert(p != NULL);
+
+    jc_pool_release(p);
+
     for (cur = p; cur != NULL; /* void */ ) {
         p = cur->data.next;
         free(cur);
@@ -110,12 +137,56 @@ void jc_pool_destroy(jc_pool_t *p)
     }
 }
 
+void jc_pool_reset(jc_pool_t *pool)
+{
+    jc_pool_t  *p;
+
+    assert(pool != NULL);
+
+    jc_pool_release(pool);
+
+    pool->data.last = (char *)jc_align((char *)pool + sizeof(jc_pool_t));
+    pool->data.fail = 0;
+    for (p = pool->data.next; p != NULL; p = p->data.next) {
+        p->data.last = (char *)jc_align((char *)p + sizeof(jc_pool_data_t));
+        p->data.fail = 0;
+    }
+
+    pool->current = pool;
+    pool->large = NULL;
+    pool->cleanup = NULL;
+    pool->freemask = 0;
+    memset(pool->free, 0, sizeof(pool->free));
+}
+
+jc_pool_cleanup_t *jc_pool_cleanup_add(jc_pool_t *p)
+{
+    jc_pool_cleanup_t  *c;
+
+    if ((c = jc_pool_alloc(p, sizeof(jc_pool_cleanup_t))) == NULL) {
+        return NULL;
+    }
+    c->handler = NULL;
+    c->data = NULL;
+    c->next = p->cleanup;
+    p->cleanup = c;
+    return c;
+}
+
 static void *jc_pool_alloc_large(jc_pool_t *p, size_t size)
 {
     jc_pool_large_t *large;
 
     assert(size > p->max);
 
+    /* an entry emptied by jc_pool_free() */
+    for (large = p->large; large != NULL; large = large->next) {
+        if (large->ptr == NULL) {
+            large->size = size;
+            return large->ptr = calloc(1, size);
+        }
+    }
+
     if ((large = jc_pool_alloc(p, sizeof(jc_pool_large_t))) == NULL) {
         return NULL;
     }
@@ -159,6 +230,61 @@ static void *jc_pool_alloc_block(jc_pool_t *pool, size_t size)
     return m;
 }
 
+/*
+ * The block whose last allocation ends at last, or NULL. Blocks are
+ * filled in order, so the walk stops at the first one still empty: after
+ * a reset the chain may be long, and all of it is empty past that.
+ * */
+static jc_pool_t *jc_pool_tail(jc_pool_t *pool, const char *last)
+{
+    jc_pool_t  *p;
+
+    for (p = pool->current; p != NULL; p = p->data.next) {
+        if (p->data.last == last) {
+            return p;
+        }
+        if (p != pool && p->data.last
+                == (char *)jc_align((char *)p + sizeof(jc_pool_data_t)))
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* floor(log2(size)) - 3, the class a chunk of size goes to */
+static int jc_pool_class(size_t size)
+{
+    int  c;
+
+    c = (int)(sizeof(long) * 8 - 1) - __builtin_clzl(size) - 3;
+    return c < JC_POOL_CLASSES ? c : JC_POOL_CLASSES - 1;
+}
+
+static void *jc_pool_reuse(jc_pool_t *pool, size_t size)
+{
+    int    c;
+    void  *m;
+
+    /* ceil(log2(size)) - 3, every chunk of the class fits */
+    c = size <= 8 ? 0 : (int)(sizeof(long) * 8) - __builtin_clzl(size - 1) - 3;
+    if (c >= JC_POOL_CLASSES) {
+        return NULL;
+    }
+
+    /* the first class at or above c which is not empty */
+    if ((pool->freemask >> c) == 0) {
+        return NULL;
+    }
+    c += __builtin_ctz(pool->freemask >> c);
+
+    m = pool->free[c];
+    if ((pool->free[c] = *(void **)m) == NULL) {
+        pool->freemask &= ~(1u << c);
+    }
+    return m;
+}
+
 void *jc_pool_alloc(jc_pool_t *pool, size_t size)
 {
     void       *m;
@@ -172,6 +298,10 @@ void *jc_pool_alloc(jc_pool_t *pool, size_t size)
         return jc_pool_alloc_large(pool, size);
     }
 
+    if (pool->freemask != 0 && (m = jc_pool_reuse(pool, size)) != NULL) {
+        return m;
+    }
+
     p = pool->current;
 
     do {
@@ -189,3 +319,113 @@ void *jc_pool_alloc(jc_pool_t *pool, size_t size)
     return jc_pool_alloc_block(pool, size);
 }
 
+
+void jc_pool_free(jc_pool_t *pool, void *m, size_t size)
+{
+    int               c;
+    jc_pool_t        *p;
+    jc_pool_large_t  *large;
+
+    assert(pool != NULL);
+
+    size = jc_align(size);
+
+    if (m == NULL || size < sizeof(void *)) {
+        return;
+    }
+
+    if (size > pool->max) {
+        for (large = pool->large; large != NULL; large = large->next) {
+            if (large->ptr == m) {
+                free(m);
+                large->ptr = NULL;
+                return;
+            }
+        }
+        return;
+    }
+
+    /* the last allocation of a block is just taken back */
+    if ((p = jc_pool_tail(pool, (char *)m + size)) != NULL) {
+        p->data.last = m;
+        return;
+    }
+
+    c = jc_pool_class(size);
+    *(void **)m = pool->free[c];
+    pool->free[c] = m;
+    pool->freemask |= 1u << c;
+}
+
+/*
+ * Resize m, which was got from jc_pool_alloc(pool, old_size).
+ * If m is the last allocation of its block it is resized in place,
+ * which is the common case for data built up at the tail of the pool.
+ * Otherwise a new chunk is allocated and the old one goes to the
+ * free lists.
+ * */
+void *jc_pool_realloc(jc_pool_t *pool, void *m, size_t old_size,
+        size_t new_size)
+{
+    void             *n;
+    jc_pool_t        *p;
+    jc_pool_large_t  *large;
+
+    assert(pool != NULL);
+
+    if (m == NULL) {
+        return jc_pool_alloc(pool, new_size);
+    }
+
+    old_size = jc_align(old_size);
+    new_size = jc_align(new_size);
+
+    if (old_size > pool->max) {
+        for (large = pool->large; large != NULL; large = large->next) {
+            if (large->ptr == m) {
+                break;
+            }
+        }
+        assert(large != NULL);
+        /* a chunk is large or not by its size, it moves if that changes */
+        if (new_size <= pool->max) {
+            if ((n = jc_pool_alloc(pool, new_size)) == NULL) {
+                return NULL;
+            }
+            memcpy(n, m, new_size);
+            free(m);
+            large->ptr = NULL;
+            return n;
+        }
+        if (new_size <= large->size) {
+            return m;
+        }
+        if ((n = realloc(m, new_size)) == NULL) {
+            return NULL;
+        }
+        large->ptr = n;
+        large->size = new_size;
+        return n;
+    }
+
+    /* in place only up to max, a bigger chunk must be a large one */
+    p = jc_pool_tail(pool, (char *)m + old_size);
+    if (p != NULL && new_size <= pool->max
+            && (size_t)(p->data.end - (char *)m) > new_size)
+    {
+        p->data.last = (char *)m + new_size;
+        return m;
+    }
+
+    if (new_size <= old_size) {
+        jc_pool_free(pool, (char *)m + new_size, old_size - new_size);
+        return m;
+    }
+
+    if ((n = jc_pool_alloc(pool, new_size)) == NULL) {
+        return NULL;
+    }
+    memcpy(n, m, old_size);
+    jc_pool_free(pool, m, old_size);
+    return n;
+}
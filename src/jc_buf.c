@@ -0,0 +1,216 @@
+#include "jc_buf.h"
+#include "jc_number.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define JC_BUF_MINSIZE 256
+
+void jc_buf_init(jc_buf_t *b)
+{
+    b->data = NULL;
+    b->len = 0;
+    b->cap = 0;
+    b->fixed = 0;
+    b->pos = 0;
+    b->done = 0;
+    b->cut = 0;
+    b->flush = NULL;
+    b->ctx = NULL;
+}
+
+void jc_buf_init_fixed(jc_buf_t *b, char *mem, size_t size)
+{
+    jc_buf_init(b);
+    b->data = mem;
+    b->cap = size;
+    b->fixed = 1;
+}
+
+void jc_buf_init_flush(jc_buf_t *b, char *mem, size_t size,
+        jc_buf_flush_pt flush, void *ctx)
+{
+    jc_buf_init_fixed(b, mem, size);
+    b->flush = flush;
+    b->ctx = ctx;
+}
+
+void jc_buf_free(jc_buf_t *b)
+{
+    if (!b->fixed) {
+        free(b->data);
+    }
+    jc_buf_init(b);
+}
+
+void jc_buf_reset(jc_buf_t *b)
+{
+    b->len = 0;
+    b->pos = 0;
+    b->done = 0;
+    b->cut = 0;
+}
+
+void jc_buf_drain(jc_buf_t *b)
+{
+    b->len = 0;
+}
+
+int jc_buf_flush(jc_buf_t *b)
+{
+    int  rc;
+
+    if (b->flush == NULL || b->len == 0) {
+        return 0;
+    }
+    rc = b->flush(b->ctx, b->data, b->len);
+    b->len = 0;
+    return rc == 0 ? 0 : -1;
+}
+
+static int jc_buf_grow(jc_buf_t *b, size_t n)
+{
+    char    *data;
+    size_t   cap;
+
+    cap = b->cap < JC_BUF_MINSIZE ? JC_BUF_MINSIZE : b->cap;
+    while (cap - b->len < n) {
+        cap *= 2;
+    }
+    if ((data = realloc(b->data, cap)) == NULL) {
+        return -1;
+    }
+    b->data = data;
+    b->cap = cap;
+    return 0;
+}
+
+int jc_buf_put(jc_buf_t *b, const char *s, size_t n)
+{
+    size_t  skip, room;
+
+    if (b->pos + n <= b->done) {
+        /* taken by a previous call */
+        b->pos += n;
+        return 0;
+    }
+    if (b->pos < b->done) {
+        skip = b->done - b->pos;
+        s += skip;
+        n -= skip;
+        b->pos += skip;
+    }
+
+    while (b->flush != NULL && b->cap - b->len < n) {
+        room = b->cap - b->len;
+        memcpy(&b->data[b->len], s, room);
+        b->len += room;
+        b->pos += room;
+        b->done += room;
+        s += room;
+        n -= room;
+        if (jc_buf_flush(b) != 0) {
+            return -1;
+        }
+    }
+
+    if (b->cap - b->len < n) {
+        if (b->fixed) {
+            room = b->cap - b->len;
+            memcpy(&b->data[b->len], s, room);
+            b->len += room;
+            b->pos += room;
+            b->done += room;
+            return JC_BUF_FULL;
+        }
+        if (jc_buf_grow(b, n) != 0) {
+            return -1;
+        }
+    }
+
+    memcpy(&b->data[b->len], s, n);
+    b->len += n;
+    b->pos += n;
+    b->done += n;
+    return 0;
+}
+
+/* the letter following '\\' in the escape of each byte, 0 if plain */
+static const char jc_escape_table[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '\"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '/',
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const char jc_hex_digits[] = "0123456789abcdef";
+
+int jc_buf_put_str(jc_buf_t *b, const char *s, size_t n)
+{
+    int            rc;
+    char           esc[6];
+    size_t         i, run;
+    unsigned char  ch;
+
+    if ((rc = jc_buf_putc(b, '\"')) != 0) {
+        return rc;
+    }
+
+    for (i = 0, run = 0; /* void */ ; ++i) {
+        while (i != n && jc_escape_table[(unsigned char)s[i]] == 0) {
+            ++i;
+        }
+        /* flush the plain run */
+        if ((rc = jc_buf_put(b, &s[run], i - run)) != 0) {
+            return rc;
+        }
+        if (i == n) {
+            break;
+        }
+
+        ch = (unsigned char)s[i];
+        esc[0] = '\\';
+        esc[1] = jc_escape_table[ch];
+        if (esc[1] == 'u') {
+            esc[2] = '0';
+            esc[3] = '0';
+            esc[4] = jc_hex_digits[ch >> 4];
+            esc[5] = jc_hex_digits[ch & 0xF];
+            rc = jc_buf_put(b, esc, 6);
+        } else {
+            rc = jc_buf_put(b, esc, 2);
+        }
+        if (rc != 0) {
+            return rc;
+        }
+        run = i + 1;
+    }
+
+    return jc_buf_putc(b, '\"');
+}
+
+int jc_buf_put_num(jc_buf_t *b, double d)
+{
+    char  f[JC_NUMBER_MAXLEN];
+
+    return jc_buf_put(b, f, jc_number_dtoa(d, f));
+}
+
+int jc_buf_put_int(jc_buf_t *b, int64_t i)
+{
+    char  f[JC_NUMBER_MAXLEN];
+
+    return jc_buf_put(b, f, jc_number_itoa(i, f));
+}
@@ -0,0 +1,213 @@
+#include "jc_intern.h"
+#include "jc_alloc.h"
+#include "jc_str.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define JC_INTERN_SLOTS 256
+
+/*
+ * Open addressing, at most half full. Keys are never removed and a
+ * table, once published, is only ever filled, so lookups take no lock:
+ * a slot is published after its hash and key are written. A full table
+ * is replaced by a copy twice as big and kept until the dictionary goes,
+ * for the readers still on it. Writers take the lock, and the pool of
+ * the keys is only touched under it.
+ * */
+typedef struct jc_intern_tab_s jc_intern_tab_t;
+
+struct jc_intern_tab_s {
+    size_t             mask;     /* slots - 1 */
+    jc_intern_tab_t   *prev;     /* the table it replaced */
+    uint32_t          *hash;     /* hash of the key of each slot */
+    jc_key_t          *slot[];
+};
+
+struct jc_intern_s {
+    jc_intern_tab_t   *tab;
+    pthread_mutex_t    lock;
+    size_t             size;     /* keys */
+    size_t             max;
+    unsigned           ref;
+    jc_pool_t         *pool;
+};
+
+static jc_intern_tab_t *jc_intern_tab(size_t slots, jc_intern_tab_t *prev)
+{
+    jc_intern_tab_t  *t;
+
+    t = calloc(1, sizeof(jc_intern_tab_t)
+            + slots * (sizeof(jc_key_t *) + sizeof(uint32_t)));
+    if (t == NULL) {
+        return NULL;
+    }
+    t->mask = slots - 1;
+    t->prev = prev;
+    t->hash = (uint32_t *)&t->slot[slots];
+    return t;
+}
+
+jc_intern_t *jc_intern_create(size_t max)
+{
+    jc_intern_t  *d;
+
+    if ((d = malloc(sizeof(jc_intern_t))) == NULL) {
+        return NULL;
+    }
+    d->tab = jc_intern_tab(JC_INTERN_SLOTS, NULL);
+    d->pool = jc_pool_create(4096);
+    if (d->tab == NULL || d->pool == NULL
+            || pthread_mutex_init(&d->lock, NULL) != 0)
+    {
+        if (d->pool != NULL) {
+            jc_pool_destroy(d->pool);
+        }
+        free(d->tab);
+        free(d);
+        return NULL;
+    }
+    d->size = 0;
+    d->max = max == 0 ? JC_INTERN_MAX : max;
+    d->ref = 1;
+    return d;
+}
+
+jc_intern_t *jc_intern_ref(jc_intern_t *dict)
+{
+    __atomic_add_fetch(&dict->ref, 1, __ATOMIC_RELAXED);
+    return dict;
+}
+
+void jc_intern_destroy(jc_intern_t *dict)
+{
+    jc_intern_tab_t  *t, *prev;
+
+    if (dict == NULL
+            || __atomic_sub_fetch(&dict->ref, 1, __ATOMIC_ACQ_REL) != 0)
+    {
+        return;
+    }
+    for (t = dict->tab; t != NULL; t = prev) {
+        prev = t->prev;
+        free(t);
+    }
+    pthread_mutex_destroy(&dict->lock);
+    jc_pool_destroy(dict->pool);
+    free(dict);
+}
+
+uint32_t jc_intern_hash(const char *key, size_t len)
+{
+    return jc_hash(key, len);
+}
+
+static jc_key_t *jc_intern_probe(jc_intern_tab_t *t, const char *key,
+        size_t len, uint32_t hash)
+{
+    size_t     i;
+    jc_key_t  *k;
+
+    for (i = hash & t->mask;
+            (k = __atomic_load_n(&t->slot[i], __ATOMIC_ACQUIRE)) != NULL;
+            i = (i + 1) & t->mask)
+    {
+        if (t->hash[i] == hash && k->size == len + 1
+                && memcmp(k->body, key, len) == 0)
+        {
+            return k;
+        }
+    }
+    return NULL;
+}
+
+jc_key_t *jc_intern_find(jc_intern_t *dict, const char *key, size_t len,
+        uint32_t hash)
+{
+    return jc_intern_probe(__atomic_load_n(&dict->tab, __ATOMIC_ACQUIRE),
+            key, len, hash);
+}
+
+static void jc_intern_put(jc_intern_tab_t *t, jc_key_t *k, uint32_t hash)
+{
+    size_t  i;
+
+    for (i = hash & t->mask; t->slot[i] != NULL; i = (i + 1) & t->mask) {
+        /* void */
+    }
+    t->hash[i] = hash;
+    __atomic_store_n(&t->slot[i], k, __ATOMIC_RELEASE);
+}
+
+/* publish a copy of the table twice as big, under the lock */
+static int jc_intern_grow(jc_intern_t *d)
+{
+    size_t            i;
+    jc_intern_tab_t  *old, *t;
+
+    old = d->tab;
+    if ((t = jc_intern_tab((old->mask + 1) * 2, old)) == NULL) {
+        return -1;
+    }
+    for (i = 0; i <= old->mask; ++i) {
+        if (old->slot[i] != NULL) {
+            jc_intern_put(t, old->slot[i], old->hash[i]);
+        }
+    }
+    __atomic_store_n(&d->tab, t, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* a copy of key in the pool of d, its hash in the word before it */
+static jc_key_t *jc_intern_key(jc_intern_t *d, const char *key, size_t len,
+        uint32_t hash)
+{
+    char      *m;
+    jc_key_t  *k;
+
+    m = jc_pool_alloc(d->pool, 8 + sizeof(jc_key_t) + len + 1);
+    if (m == NULL) {
+        return NULL;
+    }
+    *(uint32_t *)m = hash;
+
+    k = (jc_key_t *)(m + 8);
+    k->size = len + 1;
+    k->free = JC_STR_INTERNED;
+    memcpy(k->body, key, len);
+    k->body[len] = '\0';
+    return k;
+}
+
+jc_key_t *jc_intern_get(jc_intern_t *dict, const char *key, size_t len,
+        uint32_t hash)
+{
+    jc_key_t  *k;
+
+    if ((k = jc_intern_find(dict, key, len, hash)) != NULL) {
+        return k;
+    }
+
+    pthread_mutex_lock(&dict->lock);
+
+    /* another thread may have added it in between */
+    if ((k = jc_intern_probe(dict->tab, key, len, hash)) != NULL
+            || dict->size >= dict->max)
+    {
+        goto done;
+    }
+    if ((dict->size + 1) * 2 > dict->tab->mask + 1
+            && jc_intern_grow(dict) != 0)
+    {
+        goto done;
+    }
+    if ((k = jc_intern_key(dict, key, len, hash)) != NULL) {
+        jc_intern_put(dict->tab, k, hash);
+        ++dict->size;
+    }
+
+done:
+    pthread_mutex_unlock(&dict->lock);
+    return k;
+}
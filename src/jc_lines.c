@@ -0,0 +1,293 @@
+#include "jc_lines.h"
+#include "jc_alloc.h"
+#include "jc_scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define JC_LINES_MEMSIZE 4096
+
+#define jc_is_ws(ch) \
+    ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
+
+/* the state shared by the workers, under lock */
+typedef struct {
+    const char        *buf;
+    const char        *end;
+    const char        *next;     /* start of the next chunk */
+    size_t             chunk;
+    size_t             seq;      /* of the next chunk */
+    size_t             turn;     /* chunk to hand over next, in order */
+    int                ordered;
+    int                flags;
+    int                failed;
+    const char        *stop;     /* first record not handled, if failed */
+    ssize_t            count;
+    jc_json_each_t     each;
+    void              *ctx;
+    pthread_mutex_t    lock;
+    pthread_cond_t     cond;
+} jc_lines_t;
+
+/* a record kept until its turn */
+typedef struct {
+    jc_json_t    *js;
+    const char   *end;      /* of the record and the whitespace after it */
+} jc_lines_rec_t;
+
+/* stop every worker, at least at the record at p */
+static void jc_lines_fail(jc_lines_t *ln, const char *p)
+{
+    pthread_mutex_lock(&ln->lock);
+    if (!ln->failed || p < ln->stop) {
+        ln->stop = p;
+    }
+    /* also read without the lock, by jc_lines_each() */
+    __atomic_store_n(&ln->failed, 1, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&ln->cond);
+    pthread_mutex_unlock(&ln->lock);
+}
+
+/* the next chunk, ending at a newline, and its number; 0 if none */
+static int jc_lines_take(jc_lines_t *ln, const char **p, const char **q,
+        size_t *seq)
+{
+    const char  *nl;
+
+    pthread_mutex_lock(&ln->lock);
+    if (ln->failed || ln->next == ln->end) {
+        pthread_mutex_unlock(&ln->lock);
+        return 0;
+    }
+    *p = ln->next;
+    if ((size_t)(ln->end - *p) <= ln->chunk) {
+        *q = ln->end;
+    } else {
+        nl = memchr(*p + ln->chunk, '\n', ln->end - *p - ln->chunk);
+        *q = nl == NULL ? ln->end : nl + 1;
+    }
+    ln->next = *q;
+    *seq = ln->seq++;
+    pthread_mutex_unlock(&ln->lock);
+    return 1;
+}
+
+/* out of order, the callback of every record, until a worker fails */
+static int jc_lines_each(void *data, jc_json_t *js)
+{
+    jc_lines_t  *ln = data;
+
+    if (ln->each(ln->ctx, js) != 0) {
+        return -1;
+    }
+    /* js was handed over, the stop is past it */
+    return __atomic_load_n(&ln->failed, __ATOMIC_RELAXED) ? -1 : 0;
+}
+
+/*
+ * in order, the records of [p, q) are all parsed first, into pool; the
+ * worker then waits for the turn of its chunk to hand them over. Return
+ * 0, or -1 once the failure is told
+ * */
+static int jc_lines_chunk(jc_lines_t *ln, jc_pool_t *pool, const char *p,
+        const char *q, size_t seq, jc_lines_rec_t **rec, size_t *cap)
+{
+    size_t           i, n, size;
+    jc_json_t       *js;
+    const char      *r, *bad;
+    jc_lines_rec_t  *v;
+
+    bad = NULL;
+    size = 0;
+
+    for (r = jc_scan_ws(p, q); r != q; r += n) {
+        js = jc_json_parse_into_ex(pool, r, q - r, &n, ln->flags);
+        /* records are apart, as in jc_json_parse_lines() */
+        if (js == NULL || (r + n != q && !jc_is_ws(r[n - 1]))) {
+            bad = r;
+            break;
+        }
+        if (size == *cap) {
+            *cap = *cap ? *cap * 2 : 256;
+            if ((v = realloc(*rec, *cap * sizeof(jc_lines_rec_t))) == NULL) {
+                bad = r;
+                break;
+            }
+            *rec = v;
+        }
+        (*rec)[size].js = js;
+        (*rec)[size].end = r + n;
+        ++size;
+    }
+
+    pthread_mutex_lock(&ln->lock);
+    while (ln->turn != seq && !ln->failed) {
+        pthread_cond_wait(&ln->cond, &ln->lock);
+    }
+    if (ln->failed) {
+        pthread_mutex_unlock(&ln->lock);
+        jc_lines_fail(ln, p);
+        return -1;
+    }
+    pthread_mutex_unlock(&ln->lock);
+
+    /* the only worker whose turn it is */
+    for (i = 0; i != size; ++i) {
+        if (ln->each(ln->ctx, (*rec)[i].js) != 0) {
+            bad = (*rec)[i].end;
+            break;
+        }
+    }
+    __atomic_add_fetch(&ln->count, i, __ATOMIC_RELAXED);
+
+    if (bad != NULL) {
+        jc_lines_fail(ln, bad);
+        return -1;
+    }
+    pthread_mutex_lock(&ln->lock);
+    ++ln->turn;
+    pthread_cond_broadcast(&ln->cond);
+    pthread_mutex_unlock(&ln->lock);
+    return 0;
+}
+
+/*
+ * out of order, the records of [p, q); one left pending by
+ * jc_json_parse_lines() is complete if it ends buf. Return the
+ * records, or -1 with *used set as by jc_json_parse_lines()
+ * */
+static ssize_t jc_lines_unordered(jc_lines_t *ln, jc_pool_t *pool,
+        const char *p, const char *q, size_t *used)
+{
+    int          rc;
+    ssize_t      n;
+    jc_json_t   *js;
+
+    n = jc_json_parse_lines(pool, p, q - p, ln->flags, used,
+            jc_lines_each, ln);
+    if (n == -1 || *used == (size_t)(q - p)) {
+        return n;
+    }
+    if (q != ln->end) {
+        /* cut at a newline, a record spanning lines */
+        return -1;
+    }
+
+    js = jc_json_parse_into_ex(pool, p + *used, q - p - *used, NULL,
+            ln->flags);
+    if (js == NULL) {
+        return -1;
+    }
+    rc = jc_lines_each(ln, js);
+    jc_pool_reset(pool);
+    *used = q - p;
+    return rc == 0 ? n + 1 : -1;
+}
+
+static void *jc_lines_worker(void *data)
+{
+    size_t           seq, used, cap;
+    ssize_t          n;
+    jc_pool_t       *pool;
+    const char      *p, *q;
+    jc_lines_t      *ln = data;
+    jc_lines_rec_t  *rec;
+
+    /* one pool a worker, reset after every record or chunk */
+    if ((pool = jc_pool_create(JC_LINES_MEMSIZE)) == NULL) {
+        jc_lines_fail(ln, ln->buf);
+        return NULL;
+    }
+    rec = NULL;
+    cap = 0;
+
+    while (jc_lines_take(ln, &p, &q, &seq)) {
+        if (!ln->ordered) {
+            n = jc_lines_unordered(ln, pool, p, q, &used);
+            if (n == -1) {
+                jc_lines_fail(ln, p + used);
+                break;
+            }
+            __atomic_add_fetch(&ln->count, n, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        n = jc_lines_chunk(ln, pool, p, q, seq, &rec, &cap);
+        jc_pool_reset(pool);
+        if (n != 0) {
+            break;
+        }
+    }
+
+    free(rec);
+    jc_pool_destroy(pool);
+    return NULL;
+}
+
+ssize_t jc_lines_parse(const char *buf, size_t len,
+        const jc_lines_conf_t *conf, size_t *used,
+        jc_json_each_t each, void *ctx)
+{
+    int          i, threads;
+    pthread_t   *tid;
+    jc_lines_t   ln;
+
+    ln.buf = buf;
+    ln.end = buf + len;
+    ln.next = buf;
+    ln.chunk = conf != NULL && conf->chunk != 0 ? conf->chunk : JC_LINES_CHUNK;
+    ln.seq = 0;
+    ln.turn = 0;
+    ln.ordered = conf != NULL ? conf->ordered : 0;
+    ln.flags = conf != NULL ? conf->flags : 0;
+    ln.failed = 0;
+    ln.stop = NULL;
+    ln.count = 0;
+    ln.each = each;
+    ln.ctx = ctx;
+
+    threads = conf != NULL ? conf->threads : 0;
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads <= 0) {
+        threads = 1;
+    }
+
+    if (pthread_mutex_init(&ln.lock, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&ln.cond, NULL) != 0) {
+        pthread_mutex_destroy(&ln.lock);
+        return -1;
+    }
+
+    /* the caller is a worker too, fewer threads only mean less speed */
+    tid = threads > 1 ? malloc((threads - 1) * sizeof(pthread_t)) : NULL;
+    for (i = 0; tid != NULL && i != threads - 1; ++i) {
+        if (pthread_create(&tid[i], NULL, jc_lines_worker, &ln) != 0) {
+            break;
+        }
+    }
+    jc_lines_worker(&ln);
+    while (i-- > 0) {
+        pthread_join(tid[i], NULL);
+    }
+    free(tid);
+
+    pthread_cond_destroy(&ln.cond);
+    pthread_mutex_destroy(&ln.lock);
+
+    if (ln.failed) {
+        if (used != NULL) {
+            *used = (size_t)(ln.stop - buf);
+        }
+        return -1;
+    }
+    if (used != NULL) {
+        *used = len;
+    }
+    return ln.count;
+}
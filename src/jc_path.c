@@ -0,0 +1,143 @@
+#include "jc_path.h"
+#include "jc_alloc.h"
+
+#include <string.h>
+
+#define JC_PATH_MEMSIZE 1024
+
+jc_path_t *jc_path_find(jc_path_t *node, const char *key, size_t len)
+{
+    jc_path_t  *c;
+
+    for (c = node->child; c != NULL; c = c->next) {
+        if (key == NULL) {
+            if (c->key == NULL) {
+                return c;
+            }
+        } else if (c->key != NULL && c->len == len
+                && memcmp(c->key, key, len) == 0)
+        {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+static jc_path_t *jc_path_node(jc_pool_t *pool, const char *key, size_t len)
+{
+    char       *k;
+    jc_path_t  *node;
+
+    if ((node = jc_pool_alloc(pool, sizeof(jc_path_t))) == NULL) {
+        return NULL;
+    }
+    node->key = NULL;
+    node->len = len;
+    node->all = 0;
+    node->child = NULL;
+    node->next = NULL;
+    node->pool = NULL;
+
+    if (key != NULL) {
+        if ((k = jc_pool_alloc(pool, len + 1)) == NULL) {
+            return NULL;
+        }
+        memcpy(k, key, len);
+        k[len] = '\0';
+        node->key = k;
+    }
+    return node;
+}
+
+/* the child of node for key, added if there is none */
+static jc_path_t *jc_path_step(jc_pool_t *pool, jc_path_t *node,
+        const char *key, size_t len)
+{
+    jc_path_t  *c;
+
+    if ((c = jc_path_find(node, key, len)) != NULL) {
+        return c;
+    }
+    if ((c = jc_path_node(pool, key, len)) == NULL) {
+        return NULL;
+    }
+    c->next = node->child;
+    node->child = c;
+    return c;
+}
+
+/* add the path s to the tree of root, return 0 or -1 */
+static int jc_path_add(jc_path_t *root, const char *s)
+{
+    int         first;
+    size_t      len;
+    jc_path_t  *node;
+
+    node = root;
+    for (first = 1; /* void */ ; first = 0) {
+        /* a key, but "[*]" may come first for an array at the top */
+        if (!first || *s != '[') {
+            len = strcspn(s, ".[");
+            if (len == 0) {
+                return -1;
+            }
+            if ((node = jc_path_step(root->pool, node, s, len)) == NULL) {
+                return -1;
+            }
+            s += len;
+        }
+
+        while (*s == '[') {
+            if (s[1] != '*' || s[2] != ']') {
+                return -1;
+            }
+            if ((node = jc_path_step(root->pool, node, NULL, 0)) == NULL) {
+                return -1;
+            }
+            s += 3;
+        }
+
+        if (*s == '\0') {
+            break;
+        }
+        if (*s++ != '.') {
+            return -1;
+        }
+    }
+
+    /* a path to a value keeps it all, the paths under it are moot */
+    node->all = 1;
+    node->child = NULL;
+    return 0;
+}
+
+jc_path_t *jc_path_create(const char *const *paths, size_t n)
+{
+    size_t      i;
+    jc_pool_t  *pool;
+    jc_path_t  *root;
+
+    if ((pool = jc_pool_create(JC_PATH_MEMSIZE)) == NULL) {
+        return NULL;
+    }
+    if ((root = jc_path_node(pool, NULL, 0)) == NULL) {
+        jc_pool_destroy(pool);
+        return NULL;
+    }
+    root->pool = pool;
+
+    for (i = 0; i != n; ++i) {
+        if (paths[i] == NULL || jc_path_add(root, paths[i]) != 0) {
+            jc_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    return root;
+}
+
+void jc_path_destroy(jc_path_t *path)
+{
+    if (path != NULL) {
+        jc_pool_destroy(path->pool);
+    }
+}
@@ -0,0 +1,283 @@
+#include "jc_reduce.h"
+
+#include <assert.h>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+# define JC_REDUCE_AVX2
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+# define JC_REDUCE_SSE2
+#endif
+
+double jc_sum_f64(const double *x, size_t n)
+{
+    size_t   i;
+    double   sum;
+#if defined(JC_REDUCE_AVX2)
+    double   lane[4];
+    __m256d  a, b, c, d;
+
+    a = b = c = d = _mm256_setzero_pd();
+    for (i = 0; i + 16 <= n; i += 16) {
+        a = _mm256_add_pd(a, _mm256_loadu_pd(x + i));
+        b = _mm256_add_pd(b, _mm256_loadu_pd(x + i + 4));
+        c = _mm256_add_pd(c, _mm256_loadu_pd(x + i + 8));
+        d = _mm256_add_pd(d, _mm256_loadu_pd(x + i + 12));
+    }
+    _mm256_storeu_pd(lane, _mm256_add_pd(_mm256_add_pd(a, b),
+                                         _mm256_add_pd(c, d)));
+    sum = (lane[0] + lane[1]) + (lane[2] + lane[3]);
+#elif defined(JC_REDUCE_SSE2)
+    double   lane[2];
+    __m128d  a, b, c, d;
+
+    a = b = c = d = _mm_setzero_pd();
+    for (i = 0; i + 8 <= n; i += 8) {
+        a = _mm_add_pd(a, _mm_loadu_pd(x + i));
+        b = _mm_add_pd(b, _mm_loadu_pd(x + i + 2));
+        c = _mm_add_pd(c, _mm_loadu_pd(x + i + 4));
+        d = _mm_add_pd(d, _mm_loadu_pd(x + i + 6));
+    }
+    _mm_storeu_pd(lane, _mm_add_pd(_mm_add_pd(a, b), _mm_add_pd(c, d)));
+    sum = lane[0] + lane[1];
+#else
+    i = 0;
+    sum = 0;
+#endif
+
+    for (/* void */ ; i != n; ++i) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+double jc_min_f64(const double *x, size_t n)
+{
+    size_t   i;
+    double   m;
+#if defined(JC_REDUCE_AVX2)
+    double   lane[4];
+    __m256d  a, b;
+
+    assert(n != 0);
+
+    i = 0;
+    m = x[0];
+    if (n >= 8) {
+        a = _mm256_loadu_pd(x);
+        b = _mm256_loadu_pd(x + 4);
+        for (i = 8; i + 8 <= n; i += 8) {
+            a = _mm256_min_pd(a, _mm256_loadu_pd(x + i));
+            b = _mm256_min_pd(b, _mm256_loadu_pd(x + i + 4));
+        }
+        _mm256_storeu_pd(lane, _mm256_min_pd(a, b));
+        m = lane[0] < lane[1] ? lane[0] : lane[1];
+        m = m < lane[2] ? m : lane[2];
+        m = m < lane[3] ? m : lane[3];
+    }
+#elif defined(JC_REDUCE_SSE2)
+    double   lane[2];
+    __m128d  a, b;
+
+    assert(n != 0);
+
+    i = 0;
+    m = x[0];
+    if (n >= 4) {
+        a = _mm_loadu_pd(x);
+        b = _mm_loadu_pd(x + 2);
+        for (i = 4; i + 4 <= n; i += 4) {
+            a = _mm_min_pd(a, _mm_loadu_pd(x + i));
+            b = _mm_min_pd(b, _mm_loadu_pd(x + i + 2));
+        }
+        _mm_storeu_pd(lane, _mm_min_pd(a, b));
+        m = lane[0] < lane[1] ? lane[0] : lane[1];
+    }
+#else
+    assert(n != 0);
+
+    i = 0;
+    m = x[0];
+#endif
+
+    for (/* void */ ; i != n; ++i) {
+        if (x[i] < m) {
+            m = x[i];
+        }
+    }
+    return m;
+}
+
+double jc_max_f64(const double *x, size_t n)
+{
+    size_t   i;
+    double   m;
+#if defined(JC_REDUCE_AVX2)
+    double   lane[4];
+    __m256d  a, b;
+
+    assert(n != 0);
+
+    i = 0;
+    m = x[0];
+    if (n >= 8) {
+        a = _mm256_loadu_pd(x);
+        b = _mm256_loadu_pd(x + 4);
+        for (i = 8; i + 8 <= n; i += 8) {
+            a = _mm256_max_pd(a, _mm256_loadu_pd(x + i));
+            b = _mm256_max_pd(b, _mm256_loadu_pd(x + i + 4));
+        }
+        _mm256_storeu_pd(lane, _mm256_max_pd(a, b));
+        m = lane[0] > lane[1] ? lane[0] : lane[1];
+        m = m > lane[2] ? m : lane[2];
+        m = m > lane[3] ? m : lane[3];
+    }
+#elif defined(JC_REDUCE_SSE2)
+    double   lane[2];
+    __m128d  a, b;
+
+    assert(n != 0);
+
+    i = 0;
+    m = x[0];
+    if (n >= 4) {
+        a = _mm_loadu_pd(x);
+        b = _mm_loadu_pd(x + 2);
+        for (i = 4; i + 4 <= n; i += 4) {
+            a = _mm_max_pd(a, _mm_loadu_pd(x + i));
+            b = _mm_max_pd(b, _mm_loadu_pd(x + i + 2));
+        }
+        _mm_storeu_pd(lane, _mm_max_pd(a, b));
+        m = lane[0] > lane[1] ? lane[0] : lane[1];
+    }
+#else
+    assert(n != 0);
+
+    i = 0;
+    m = x[0];
+#endif
+
+    for (/* void */ ; i != n; ++i) {
+        if (x[i] > m) {
+            m = x[i];
+        }
+    }
+    return m;
+}
+
+int64_t jc_sum_i64(const int64_t *x, size_t n)
+{
+    size_t    i;
+    uint64_t  sum;
+#if defined(JC_REDUCE_AVX2)
+    uint64_t  lane[4];
+    __m256i   a, b;
+
+    a = b = _mm256_setzero_si256();
+    for (i = 0; i + 8 <= n; i += 8) {
+        a = _mm256_add_epi64(a, _mm256_loadu_si256((const __m256i *)(x + i)));
+        b = _mm256_add_epi64(b,
+                _mm256_loadu_si256((const __m256i *)(x + i + 4)));
+    }
+    _mm256_storeu_si256((__m256i *)lane, _mm256_add_epi64(a, b));
+    sum = lane[0] + lane[1] + lane[2] + lane[3];
+#elif defined(JC_REDUCE_SSE2)
+    uint64_t  lane[2];
+    __m128i   a, b;
+
+    a = b = _mm_setzero_si128();
+    for (i = 0; i + 4 <= n; i += 4) {
+        a = _mm_add_epi64(a, _mm_loadu_si128((const __m128i *)(x + i)));
+        b = _mm_add_epi64(b, _mm_loadu_si128((const __m128i *)(x + i + 2)));
+    }
+    _mm_storeu_si128((__m128i *)lane, _mm_add_epi64(a, b));
+    sum = lane[0] + lane[1];
+#else
+    i = 0;
+    sum = 0;
+#endif
+
+    /* unsigned, so that overflow wraps around */
+    for (/* void */ ; i != n; ++i) {
+        sum += (uint64_t)x[i];
+    }
+    return (int64_t)sum;
+}
+
+/* SSE2 has no compare of 64 bit integers, only AVX2 is vectorized */
+int64_t jc_min_i64(const int64_t *x, size_t n)
+{
+    size_t   i;
+    int64_t  m;
+#if defined(JC_REDUCE_AVX2)
+    int64_t  lane[4];
+    __m256i  a, v;
+
+    assert(n != 0);
+
+    i = 0;
+    m = x[0];
+    if (n >= 4) {
+        a = _mm256_loadu_si256((const __m256i *)x);
+        for (i = 4; i + 4 <= n; i += 4) {
+            v = _mm256_loadu_si256((const __m256i *)(x + i));
+            a = _mm256_blendv_epi8(a, v, _mm256_cmpgt_epi64(a, v));
+        }
+        _mm256_storeu_si256((__m256i *)lane, a);
+        m = lane[0] < lane[1] ? lane[0] : lane[1];
+        m = m < lane[2] ? m : lane[2];
+        m = m < lane[3] ? m : lane[3];
+    }
+#else
+    assert(n != 0);
+
+    i = 0;
+    m = x[0];
+#endif
+
+    for (/* void */ ; i != n; ++i) {
+        if (x[i] < m) {
+            m = x[i];
+        }
+    }
+    return m;
+}
+
+int64_t jc_max_i64(const int64_t *x, size_t n)
+{
+    size_t   i;
+    int64_t  m;
+#if defined(JC_REDUCE_AVX2)
+    int64_t  lane[4];
+    __m256i  a, v;
+
+    assert(n != 0);
+
+    i = 0;
+    m = x[0];
+    if (n >= 4) {
+        a = _mm256_loadu_si256((const __m256i *)x);
+        for (i = 4; i + 4 <= n; i += 4) {
+            v = _mm256_loadu_si256((const __m256i *)(x + i));
+            a = _mm256_blendv_epi8(a, v, _mm256_cmpgt_epi64(v, a));
+        }
+        _mm256_storeu_si256((__m256i *)lane, a);
+        m = lane[0] > lane[1] ? lane[0] : lane[1];
+        m = m > lane[2] ? m : lane[2];
+        m = m > lane[3] ? m : lane[3];
+    }
+#else
+    assert(n != 0);
+
+    i = 0;
+    m = x[0];
+#endif
+
+    for (/* void */ ; i != n; ++i) {
+        if (x[i] > m) {
+            m = x[i];
+        }
+    }
+    return m;
+}
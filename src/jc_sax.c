@@ -0,0 +1,521 @@
+#include "jc_sax.h"
+#include "jc_scan.h"
+#include "jc_wchar.h"
+#include "jc_number.h"
+#include "jc_state.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The parser keeps no call stack of its own: every open object and
+ * array is one byte on an explicit stack, holding its jc_obj_state_t
+ * or jc_arr_state_t, so the nesting depth costs no C stack and the
+ * whole state is in jc_sax_parser_t.
+ *
+ * A token that runs into the end of a chunk is reported as
+ * JC_SAX_AGAIN and its bytes are kept in pend. The next chunk is
+ * appended up to the end of the token, which is then parsed from pend
+ * as if it had come in one piece. The state of the enclosing container
+ * is only moved on once the token is complete.
+ * */
+
+#define JC_SAX_ARRAY   0x80     /* stack entry of an array */
+#define JC_SAX_AGAIN   (-2)     /* token cut by the end of the chunk */
+
+#define jc_sax_call(s, cb, ...) \
+    ((s)->sax->cb == NULL ? 0 : (s)->sax->cb((s)->ctx, ##__VA_ARGS__))
+
+#define jc_is_ws(ch) \
+    ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
+
+/* characters of numbers and literals */
+#define jc_is_word(ch) \
+    (((ch) >= '0' && (ch) <= '9') || ((ch) >= 'a' && (ch) <= 'z') \
+     || (ch) == '-' || (ch) == '+' || (ch) == '.' || (ch) == 'E')
+
+static const char *jc_sax_skip_ws(const char *p, const char *end)
+{
+    if (p == end || !jc_is_ws(*p)) {
+        return p;
+    }
+    return jc_scan_ws(p + 1, end);
+}
+
+static int jc_sax_reserve(jc_sax_parser_t *s, size_t need)
+{
+    char    *m;
+    size_t   cap;
+
+    if (need <= s->cap) {
+        return 0;
+    }
+    for (cap = s->cap * 2; cap < need; cap *= 2) {
+        /* void */
+    }
+    if (s->scratch == s->small) {
+        if ((m = malloc(cap)) != NULL) {
+            memcpy(m, s->small, s->cap);
+        }
+    } else {
+        m = realloc(s->scratch, cap);
+    }
+    if (m == NULL) {
+        return -1;
+    }
+    s->scratch = m;
+    s->cap = cap;
+    return 0;
+}
+
+static int jc_sax_pend(jc_sax_parser_t *s, const char *p, size_t n)
+{
+    char    *m;
+    size_t   cap;
+
+    if (n == 0) {
+        return 0;
+    }
+    if (s->plen + n > s->pcap) {
+        for (cap = s->pcap ? s->pcap * 2 : 64; cap < s->plen + n; cap *= 2) {
+            /* void */
+        }
+        if ((m = realloc(s->pend, cap)) == NULL) {
+            return -1;
+        }
+        s->pend = m;
+        s->pcap = cap;
+    }
+    memcpy(s->pend + s->plen, p, n);
+    s->plen += n;
+    return 0;
+}
+
+/*
+ * read the string at p, *str and *len are set to its decoded bytes,
+ * return the bytes consumed, -1 or JC_SAX_AGAIN
+ * */
+static ssize_t jc_sax_string(jc_sax_parser_t *s, const char *p,
+        const char *end, const char **str, size_t *len)
+{
+    int          n;
+    size_t       size, used;
+    const char  *q, *r;
+
+    r = p + 1;
+    if ((q = jc_scan_str(r, end)) == end) {
+        return JC_SAX_AGAIN;
+    }
+    if (*q == '\"') {
+        /* no escapes, zero copy */
+        *str = r;
+        *len = q - r;
+        return q + 1 - p;
+    }
+
+    for (size = 0; /* void */ ; /* void */ ) {
+        if (jc_sax_reserve(s, size + (q - r) + JC_UNESCAPE_MAX) != 0) {
+            return -1;
+        }
+        memcpy(&s->scratch[size], r, q - r);
+        size += q - r;
+
+        if (*q == '\"') {
+            break;
+        }
+        if ((n = jc_unescape(q, end, &s->scratch[size], &used)) == -1) {
+            /* the longest escape is a surrogate pair, 12 bytes */
+            return end - q < 12 ? JC_SAX_AGAIN : -1;
+        }
+        size += n;
+        r = q + used;
+
+        if ((q = jc_scan_str(r, end)) == end) {
+            return JC_SAX_AGAIN;
+        }
+    }
+
+    *str = s->scratch;
+    *len = size;
+    return q + 1 - p;
+}
+
+static ssize_t jc_sax_literal(const char *p, const char *end,
+        const char *lit, size_t n)
+{
+    if ((size_t)(end - p) >= n) {
+        return memcmp(p, lit, n) == 0 ? (ssize_t)n : -1;
+    }
+    return memcmp(p, lit, end - p) == 0 ? JC_SAX_AGAIN : -1;
+}
+
+/* read a value which is not an object or array */
+static ssize_t jc_sax_scalar(jc_sax_parser_t *s, const char *p,
+        const char *end)
+{
+    size_t        len;
+    ssize_t       n;
+    const char   *str, *q;
+    jc_number_t   num;
+
+    switch (*p) {
+        case '\"':
+            if ((n = jc_sax_string(s, p, end, &str, &len)) < 0) {
+                return n;
+            }
+            return jc_sax_call(s, string, str, len) == 0 ? n : -1;
+
+        case 't':
+            if ((n = jc_sax_literal(p, end, "true", 4)) < 0) {
+                return n;
+            }
+            return jc_sax_call(s, boolean, 1) == 0 ? n : -1;
+
+        case 'f':
+            if ((n = jc_sax_literal(p, end, "false", 5)) < 0) {
+                return n;
+            }
+            return jc_sax_call(s, boolean, 0) == 0 ? n : -1;
+
+        case 'n':
+            if ((n = jc_sax_literal(p, end, "null", 4)) < 0) {
+                return n;
+            }
+            return jc_sax_call(s, null) == 0 ? n : -1;
+
+        default:
+            n = jc_number_parse(p, end, &num);
+            if ((n == -1 || p + n == end) && !s->last) {
+                /* the number may go on in the next chunk */
+                for (q = p; q != end && jc_is_word(*q); ++q) {
+                    /* void */
+                }
+                if (q == end) {
+                    return JC_SAX_AGAIN;
+                }
+            }
+            if (n == -1) {
+                return -1;
+            }
+            if (num.is_int) {
+                if (s->sax->integer != NULL) {
+                    return s->sax->integer(s->ctx, num.i) == 0 ? n : -1;
+                }
+                /* no integer callback, report it as a number */
+                num.d = (double)num.i;
+            }
+            return jc_sax_call(s, number, num.d) == 0 ? n : -1;
+    }
+}
+
+/* read any value, objects and arrays are only opened */
+static ssize_t jc_sax_value(jc_sax_parser_t *s, const char *p,
+        const char *end)
+{
+    switch (*p) {
+        case '{':
+            if (s->depth == JC_SAX_MAXDEPTH
+                    || jc_sax_call(s, start_object) != 0)
+            {
+                return -1;
+            }
+            s->stack[s->depth++] = JC_OBJ_LBRACE;
+            return 1;
+
+        case '[':
+            if (s->depth == JC_SAX_MAXDEPTH
+                    || jc_sax_call(s, start_array) != 0)
+            {
+                return -1;
+            }
+            s->stack[s->depth++] = JC_SAX_ARRAY | JC_ARR_START;
+            return 1;
+
+        default:
+            return jc_sax_scalar(s, p, end);
+    }
+}
+
+/*
+ * run the state machine over [buf, buf + len), return the bytes
+ * consumed, -1 or JC_SAX_AGAIN. Stops early only after the value at
+ * the top is read, at the first byte that is not whitespace.
+ * */
+static ssize_t jc_sax_exec(jc_sax_parser_t *s, const char *buf, size_t len)
+{
+    int             d;
+    size_t          klen;
+    ssize_t         n;
+    const char     *p, *end, *key;
+    unsigned char   st;
+
+    end = buf + len;
+
+    for (p = buf; /* void */ ; /* void */ ) {
+        if ((p = jc_sax_skip_ws(p, end)) == end) {
+            return p - buf;
+        }
+
+        if (s->depth == 0) {
+            if (s->started) {
+                /* s->done, stop before whatever follows */
+                return p - buf;
+            }
+            /* any value at the top, a scalar is all there is */
+            if ((n = jc_sax_value(s, p, end)) < 0) {
+                return n == JC_SAX_AGAIN ? p - buf : -1;
+            }
+            s->started = 1;
+            if (s->depth == 0) {
+                s->done = 1;
+            }
+            p += n;
+            continue;
+        }
+
+        d = s->depth - 1;
+        st = s->stack[d];
+        n = 0;
+
+        if (st & JC_SAX_ARRAY) {
+            switch ((jc_arr_state_t)(st & ~JC_SAX_ARRAY)) {
+                case JC_ARR_START:
+                    if (*p == ']') {
+                        goto end_array;
+                    }
+                    /* fall through */
+                case JC_ARR_VAL:
+                    if ((n = jc_sax_value(s, p, end)) < 0) {
+                        return n == JC_SAX_AGAIN ? p - buf : -1;
+                    }
+                    s->stack[d] = JC_SAX_ARRAY | JC_ARR_COMMA;
+                    break;
+
+                case JC_ARR_COMMA:
+                    if (*p == ',') {
+                        s->stack[d] = JC_SAX_ARRAY | JC_ARR_VAL;
+                        n = 1;
+                        break;
+                    } else if (*p == ']') {
+                        goto end_array;
+                    }
+                    return -1;
+
+                default:
+                    return -1;
+            }
+            p += n;
+            continue;
+
+end_array:
+            ++p;
+            if (--s->depth == 0) {
+                s->done = 1;
+            }
+            if (jc_sax_call(s, end_array) != 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        switch ((jc_obj_state_t)st) {
+            case JC_OBJ_LBRACE:
+                if (*p == '}') {
+                    goto end_object;
+                }
+                /* fall through */
+            case JC_OBJ_KEY:
+                if (*p != '\"') {
+                    return -1;
+                }
+                if ((n = jc_sax_string(s, p, end, &key, &klen)) < 0) {
+                    return n == JC_SAX_AGAIN ? p - buf : -1;
+                }
+                if (jc_sax_call(s, key, key, klen) != 0) {
+                    return -1;
+                }
+                s->stack[d] = JC_OBJ_COLON;
+                break;
+
+            case JC_OBJ_COLON:
+                if (*p != ':') {
+                    return -1;
+                }
+                s->stack[d] = JC_OBJ_VAL;
+                n = 1;
+                break;
+
+            case JC_OBJ_VAL:
+                if ((n = jc_sax_value(s, p, end)) < 0) {
+                    return n == JC_SAX_AGAIN ? p - buf : -1;
+                }
+                s->stack[d] = JC_OBJ_COMMA;
+                break;
+
+            case JC_OBJ_COMMA:
+                if (*p == ',') {
+                    s->stack[d] = JC_OBJ_KEY;
+                    n = 1;
+                    break;
+                } else if (*p == '}') {
+                    goto end_object;
+                }
+                return -1;
+
+            default:
+                return -1;
+        }
+        p += n;
+        continue;
+
+end_object:
+        ++p;
+        if (--s->depth == 0) {
+            s->done = 1;
+        }
+        if (jc_sax_call(s, end_object) != 0) {
+            return -1;
+        }
+    }
+}
+
+/* return the bytes of p which belong to the pending token, *more is
+ * set if the token goes on after end */
+static size_t jc_sax_token_end(jc_sax_parser_t *s, const char *p,
+        const char *end, int *more)
+{
+    size_t       i;
+    const char  *q;
+
+    *more = 1;
+    q = p;
+
+    if (s->pend[0] != '\"') {
+        while (q != end && jc_is_word(*q)) {
+            ++q;
+        }
+        *more = q == end;
+        return q - p;
+    }
+
+    /* an odd run of backslashes escapes the first byte of p */
+    for (i = s->plen; i > 1 && s->pend[i - 1] == '\\'; --i) {
+        /* void */
+    }
+    if ((s->plen - i) & 1) {
+        if (q == end) {
+            return 0;
+        }
+        ++q;
+    }
+
+    for ( ;; ) {
+        if ((q = jc_scan_str(q, end)) == end) {
+            return q - p;
+        }
+        if (*q++ == '\"') {
+            *more = 0;
+            return q - p;
+        }
+        if (q == end) {
+            return q - p;
+        }
+        ++q;
+    }
+}
+
+void jc_sax_init(jc_sax_parser_t *sp, const jc_sax_t *sax, void *ctx)
+{
+    sp->sax = sax;
+    sp->ctx = ctx;
+    sp->depth = 0;
+    sp->started = 0;
+    sp->done = 0;
+    sp->last = 0;
+    sp->pend = NULL;
+    sp->plen = 0;
+    sp->pcap = 0;
+    sp->scratch = sp->small;
+    sp->cap = sizeof(sp->small);
+}
+
+int jc_sax_feed(jc_sax_parser_t *sp, const char *buf, size_t len)
+{
+    int       more;
+    size_t    n;
+    ssize_t   rc;
+
+    if (sp->plen != 0) {
+        n = jc_sax_token_end(sp, buf, buf + len, &more);
+        if (jc_sax_pend(sp, buf, n) != 0) {
+            return -1;
+        }
+        if (more) {
+            return 0;
+        }
+
+        /* the token is whole, nothing follows it in pend */
+        sp->last = 1;
+        rc = jc_sax_exec(sp, sp->pend, sp->plen);
+        sp->last = 0;
+        if (rc != (ssize_t)sp->plen) {
+            return -1;
+        }
+        sp->plen = 0;
+        buf += n;
+        len -= n;
+    }
+
+    if ((rc = jc_sax_exec(sp, buf, len)) == -1) {
+        return -1;
+    }
+    if (sp->done) {
+        /* only whitespace may follow the value */
+        return (size_t)rc == len ? 0 : -1;
+    }
+    return jc_sax_pend(sp, buf + rc, len - rc);
+}
+
+int jc_sax_finish(jc_sax_parser_t *sp)
+{
+    ssize_t   rc;
+
+    if (sp->plen != 0) {
+        /* a number can only end at the end of the input */
+        sp->last = 1;
+        rc = jc_sax_exec(sp, sp->pend, sp->plen);
+        if (rc != (ssize_t)sp->plen) {
+            return -1;
+        }
+        sp->plen = 0;
+    }
+    return sp->done ? 0 : -1;
+}
+
+void jc_sax_free(jc_sax_parser_t *sp)
+{
+    if (sp->scratch != sp->small) {
+        free(sp->scratch);
+        sp->scratch = sp->small;
+    }
+    free(sp->pend);
+    sp->pend = NULL;
+}
+
+ssize_t jc_sax_parse(const char *buf, size_t len, const jc_sax_t *sax,
+        void *ctx)
+{
+    ssize_t           n;
+    jc_sax_parser_t   s;
+
+    jc_sax_init(&s, sax, ctx);
+    s.last = 1;
+
+    n = jc_sax_exec(&s, buf, len);
+    if (n != -1 && !s.done) {
+        n = -1;
+    }
+
+    jc_sax_free(&s);
+    return n;
+}
@@ -0,0 +1,301 @@
+#include "jc_scan.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+# define JC_SCAN_AVX2
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+# define JC_SCAN_SSE2
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+# define JC_SCAN_SWAR
+#endif
+
+#ifdef JC_SCAN_SWAR
+#define JC_ONES  0x0101010101010101ULL
+#define JC_HIGHS 0x8080808080808080ULL
+
+/* high bit set in the lowest byte of x which is zero (exact for the
+ * lowest one, which is all we need) */
+#define jc_swar_zero(x)  (((x) - JC_ONES) & ~(x) & JC_HIGHS)
+#define jc_swar_eq(x, c) jc_swar_zero((x) ^ (JC_ONES * (uint8_t)(c)))
+#endif
+
+static int jc_is_ws(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+const char *jc_scan_ws(const char *p, const char *end)
+{
+#if defined(JC_SCAN_AVX2)
+    __m256i   v, ws;
+    uint32_t  mask;
+
+    for (/* void */ ; end - p >= 32; p += 32) {
+        v = _mm256_loadu_si256((const __m256i *)p);
+        ws = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+        mask = ~(uint32_t)_mm256_movemask_epi8(ws);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+#elif defined(JC_SCAN_SSE2)
+    __m128i   v, ws;
+    uint32_t  mask;
+
+    for (/* void */ ; end - p >= 16; p += 16) {
+        v = _mm_loadu_si128((const __m128i *)p);
+        ws = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+        mask = ~(uint32_t)_mm_movemask_epi8(ws) & 0xFFFF;
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    while (p != end && jc_is_ws(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+const char *jc_scan_str(const char *p, const char *end)
+{
+#if defined(JC_SCAN_AVX2)
+    __m256i   v;
+    uint32_t  mask;
+
+    for (/* void */ ; end - p >= 32; p += 32) {
+        v = _mm256_loadu_si256((const __m256i *)p);
+        mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+#elif defined(JC_SCAN_SSE2)
+    __m128i   v;
+    uint32_t  mask;
+
+    for (/* void */ ; end - p >= 16; p += 16) {
+        v = _mm_loadu_si128((const __m128i *)p);
+        mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(
+                    _mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                    _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+#elif defined(JC_SCAN_SWAR)
+    uint64_t  v, mask;
+
+    for (/* void */ ; end - p >= 8; p += 8) {
+        memcpy(&v, p, sizeof(v));
+        mask = jc_swar_eq(v, '"') | jc_swar_eq(v, '\\');
+        if (mask != 0) {
+            return p + (__builtin_ctzll(mask) >> 3);
+        }
+    }
+#endif
+
+    while (p != end && *p != '"' && *p != '\\') {
+        ++p;
+    }
+    return p;
+}
+
+/*
+ * jc_scan_skip() looks at 64 bytes a step: a mask of their quotes,
+ * backslashes, opening and closing brackets, one bit a byte. '{' and '['
+ * are 0x7b and 0x5b, '}' and ']' 0x7d and 0x5d, so or'ed with 0x20 each
+ * kind of bracket is a single byte.
+ * */
+#define JC_SCAN_BLOCK 64
+
+typedef struct {
+    uint64_t  quote;
+    uint64_t  bs;
+    uint64_t  open;
+    uint64_t  close;
+} jc_scan_mask_t;
+
+#ifdef JC_SCAN_SWAR
+/* high bit set in every byte of x which is zero */
+#define jc_swar_zero_all(x)                                               \
+    (~((((x) & ~JC_HIGHS) + ~JC_HIGHS) | (x) | ~JC_HIGHS))
+#define jc_swar_eq_all(x, c) jc_swar_zero_all((x) ^ (JC_ONES * (uint8_t)(c)))
+/* the high bits of the 8 bytes, as 8 bits */
+#define jc_swar_pack(m)  ((((m) >> 7) * 0x0102040810204080ULL) >> 56)
+#endif
+
+static void jc_scan_classify(const char *p, jc_scan_mask_t *m)
+{
+    int       i;
+#if defined(JC_SCAN_AVX2)
+    __m256i   v, b;
+
+    m->quote = m->bs = m->open = m->close = 0;
+    for (i = 0; i != JC_SCAN_BLOCK; i += 32) {
+        v = _mm256_loadu_si256((const __m256i *)(p + i));
+        b = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        m->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << i;
+        m->bs |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << i;
+        m->open |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(b, _mm256_set1_epi8('{'))) << i;
+        m->close |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(b, _mm256_set1_epi8('}'))) << i;
+    }
+#elif defined(JC_SCAN_SSE2)
+    __m128i   v, b;
+
+    m->quote = m->bs = m->open = m->close = 0;
+    for (i = 0; i != JC_SCAN_BLOCK; i += 16) {
+        v = _mm_loadu_si128((const __m128i *)(p + i));
+        b = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        m->quote |= (uint64_t)_mm_movemask_epi8(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << i;
+        m->bs |= (uint64_t)_mm_movemask_epi8(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << i;
+        m->open |= (uint64_t)_mm_movemask_epi8(
+                _mm_cmpeq_epi8(b, _mm_set1_epi8('{'))) << i;
+        m->close |= (uint64_t)_mm_movemask_epi8(
+                _mm_cmpeq_epi8(b, _mm_set1_epi8('}'))) << i;
+    }
+#elif defined(JC_SCAN_SWAR)
+    uint64_t  v, b;
+
+    m->quote = m->bs = m->open = m->close = 0;
+    for (i = 0; i != JC_SCAN_BLOCK; i += 8) {
+        memcpy(&v, p + i, sizeof(v));
+        b = v | (JC_ONES * 0x20);
+        m->quote |= jc_swar_pack(jc_swar_eq_all(v, '"')) << i;
+        m->bs |= jc_swar_pack(jc_swar_eq_all(v, '\\')) << i;
+        m->open |= jc_swar_pack(jc_swar_eq_all(b, '{')) << i;
+        m->close |= jc_swar_pack(jc_swar_eq_all(b, '}')) << i;
+    }
+#else
+    unsigned  c;
+
+    m->quote = m->bs = m->open = m->close = 0;
+    for (i = 0; i != JC_SCAN_BLOCK; ++i) {
+        c = (unsigned char)p[i];
+        m->quote |= (uint64_t)(c == '"') << i;
+        m->bs |= (uint64_t)(c == '\\') << i;
+        m->open |= (uint64_t)((c | 0x20) == '{') << i;
+        m->close |= (uint64_t)((c | 0x20) == '}') << i;
+    }
+#endif
+}
+
+/* bit i of the result is the xor of bits 0 to i of x */
+static uint64_t jc_prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+typedef struct {
+    size_t    depth;
+    uint64_t  in_str;    /* all ones inside a string */
+    int       esc;       /* the next byte is escaped */
+} jc_skip_state_t;
+
+/* one byte at a time, from the state st; the byte past the bracket
+ * closing the first one, or NULL if it is not in [p, end) */
+static const char *jc_scan_skip_bytes(const char *p, const char *end,
+        jc_skip_state_t *st)
+{
+    unsigned  c;
+
+    for (/* void */ ; p != end; ++p) {
+        c = (unsigned char)*p;
+        if (st->esc) {
+            st->esc = 0;
+        } else if (st->in_str) {
+            if (c == '\\') {
+                st->esc = 1;
+            } else if (c == '"') {
+                st->in_str = 0;
+            }
+        } else if (c == '"') {
+            st->in_str = ~(uint64_t)0;
+        } else if ((c | 0x20) == '{') {
+            ++st->depth;
+        } else if ((c | 0x20) == '}' && --st->depth == 0) {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Without backslashes, the bytes inside strings of a block are the prefix
+ * xor of its quotes, and the brackets there are dropped. The brackets
+ * left only change the depth, unless there are enough closing ones to
+ * reach 0; then they are walked in order. A block with a backslash is
+ * walked byte by byte.
+ * */
+const char *jc_scan_skip(const char *p, const char *end)
+{
+    int              i;
+    uint64_t         str, br;
+    const char      *q;
+    jc_scan_mask_t   m;
+    jc_skip_state_t  st;
+
+    st.depth = 0;
+    st.in_str = 0;
+    st.esc = 0;
+
+    for (/* void */ ; end - p >= JC_SCAN_BLOCK; p += JC_SCAN_BLOCK) {
+        jc_scan_classify(p, &m);
+
+        if (m.bs != 0 || st.esc) {
+            q = jc_scan_skip_bytes(p, p + JC_SCAN_BLOCK, &st);
+            if (q != NULL) {
+                return q;
+            }
+            continue;
+        }
+
+        str = jc_prefix_xor(m.quote) ^ st.in_str;
+        st.in_str = (uint64_t)((int64_t)str >> 63);
+        m.open &= ~str;
+        m.close &= ~str;
+
+        if ((size_t)__builtin_popcountll(m.close) < st.depth) {
+            st.depth += __builtin_popcountll(m.open);
+            st.depth -= __builtin_popcountll(m.close);
+            continue;
+        }
+        for (br = m.open | m.close; br != 0; br &= br - 1) {
+            i = __builtin_ctzll(br);
+            if (m.open >> i & 1) {
+                ++st.depth;
+            } else if (--st.depth == 0) {
+                return p + i + 1;
+            }
+        }
+    }
+
+    return jc_scan_skip_bytes(p, end, &st);
+}
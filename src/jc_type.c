@@ -1,143 +1,326 @@
 #include "jc_type.h"
 #include "jc_alloc.h"
 #include "jc_wchar.h"
+#include "jc_scan.h"
+#include "jc_number.h"
+#include "jc_state.h"
+#include "jc_sax.h"
+#include "jc_str.h"
+#include "jc_intern.h"
+#include "jc_reduce.h"
+#include "jc_path.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
 #define JC_MEMSIZE 1024
 #define JC_INCSTEP 16
-#define JC_MICRO 1e-7
 
-struct jc_str_s {
-    size_t   size;     /* size of str */
-    size_t   free;     /* free space */
-    char     body[];   /* str */
-};
+/* JC_INT and JC_NUM are the same json type */
+#define jc_json_type(t) ((t) == JC_INT ? JC_NUM : (t))
+
+/*
+ * An array of numbers is kept packed, 8 bytes a number in data: all of
+ * them JC_INT, or JC_NUM with integers too if they convert exactly.
+ * A bit a number follows them in data, set for the integers among
+ * doubles so that they are still read back as JC_INT. value is then
+ * only a copy made on demand by jc_array_get(). Any other array is kept
+ * in value, its values may be of any types.
+ * */
+#define JC_PACK_NONE  0
+#define JC_PACK_F64   1
+#define JC_PACK_I64   2
+
+/* bytes of data for cap packed numbers */
+#define jc_pack_size(cap) ((cap) * sizeof(double) + ((cap) + 7) / 8)
+
+#define JC_MIXED      (-1)
+
+/* integers which are exact in a double */
+#define jc_f64_exact(i) ((i) >= -(1LL << 53) && (i) <= (1LL << 53))
 
 struct jc_array_s {
     size_t      size;     /* length of array */
     size_t      free;     /* free size of array */
-    jc_val_t  **value;
+    jc_val_t   *value;
+    void       *data;     /* packed numbers */
+    int         pack;     /* JC_PACK_* */
+    int         type;     /* json type of all values, or JC_MIXED */
+    jc_pool_t  *pool;     /* mem pool of the json owning it */
+    jc_json_t  *root;     /* document owning it */
+};
+
+/* one member of an object, while the keys are sorted */
+typedef struct {
+    jc_key_t  *key;
+    jc_val_t   val;
+} jc_kv_t;
+
+typedef struct jc_shape_s jc_shape_t;
+
+/*
+ * The keys of an object, in order, and their index. When a parsed object
+ * closes, its shape is looked up in the cache of the document, and one
+ * with the same keys is shared instead. A shared shape never changes: an
+ * object adding a key to it first takes a copy of its own.
+ * */
+struct jc_shape_s {
+    size_t        size;     /* keys */
+    size_t        free;     /* room for more keys */
+    jc_key_t    **key;
+    uint32_t     *index;    /* hash of keys to 1 + their position */
+    size_t        mask;     /* slots of index - 1 */
+    int           sorted;   /* keys are in order, not appended */
+    int           shared;
+    uint32_t      hash;     /* of the keys, of a shared shape */
+    jc_shape_t   *next;     /* in the cache */
 };
 
+/* shared shapes of a document, by the hash of their keys */
+typedef struct {
+    jc_shape_t  **bucket;
+    size_t        mask;     /* buckets - 1 */
+    size_t        size;     /* shapes */
+} jc_shapes_t;
+
 struct jc_json_s {
-    size_t       size;     /* size of keys and values */
-    size_t       free;     /* free size of keys and values */
-    jc_key_t   **keys;     /* keys of json */
-    jc_val_t   **vals;     /* values of json */
+    jc_shape_t  *shape;    /* keys */
+    jc_val_t    *val;      /* values, in the order of the keys */
+    size_t       free;     /* room for more values */
+    int          flags;    /* JC_JSON_*, the same in a whole document */
     jc_pool_t   *pool;     /* mem pool of json */
-    size_t       ref;      /* refcount */
+    jc_json_t   *root;     /* document owning pool, may be itself */
+    size_t       ref;      /* refcount, of a root only */
+    int          owner;    /* pool is destroyed with the root */
+    jc_intern_t *dict;     /* shared keys, the same in a whole document */
+    jc_buf_t    *str;      /* output of jc_json_str() */
+    jc_shapes_t *shapes;   /* shape cache, of a root only */
+    jc_val_t    *top;      /* the value parsed if not an object, of a root,
+                              or itself once asked for by jc_json_value() */
 };
 
-static int __jc_json_str(jc_json_t *js, char *p);
-static size_t __jc_json_val_size(jc_val_t *val);
-static size_t __jc_json_size(jc_json_t *js);
-static int __jc_json_parse_key(jc_json_t *js, const char *p, jc_key_t **key);
-static int __jc_json_parse_val(jc_json_t *js, const char *p, jc_val_t **val);
-static void __jc_json_cleanup(jc_val_t *val);
-
-jc_json_t *jc_json_create()
+/* js holds keys, not a value of another type parsed at the top */
+#define jc_json_is_obj(js) ((js)->top == NULL || (js)->top->type == JC_JSON)
+
+/* of every empty object */
+static jc_shape_t jc_shape_empty = { 0, 0, NULL, NULL, 0, 1, 1, 0, NULL };
+
+static int __jc_json_write(jc_json_t *js, jc_buf_t *b);
+static jc_key_t *jc_key_n(jc_pool_t *pool, const char *key, size_t key_len);
+static ssize_t __jc_json_parse_key(jc_json_t *js, const char *p,
+        const char *end, jc_key_t **key);
+static ssize_t __jc_json_parse_name(jc_json_t *js, const char *p,
+        const char *end, jc_key_t **key, jc_shape_t *hint);
+static ssize_t __jc_json_parse_sub_json(jc_json_t *js, const char *p,
+        const char *end, jc_val_t *js_val, jc_shape_t *hint,
+        jc_path_t *path);
+static ssize_t __jc_json_parse_val(jc_json_t *js, const char *p,
+        const char *end, jc_val_t *val);
+static ssize_t __jc_json_parse_array(jc_json_t *js, const char *p,
+        const char *end, jc_val_t *val, jc_path_t *path);
+static int jc_json_set_top(jc_json_t *js, jc_val_t *val);
+
+/* a json living in pool, which belongs to root */
+static jc_json_t *jc_json_alloc(jc_pool_t *pool, jc_json_t *root)
 {
-    jc_pool_t   *pool;
     jc_json_t   *json;
 
-    if ((pool = jc_pool_create(JC_MEMSIZE)) == NULL) {
-        return NULL;
-    }
     if ((json = jc_pool_alloc(pool, sizeof(jc_json_t))) == NULL) {
-        goto free;
+        return NULL;
     }
-    json->size = 0;
+    json->shape = &jc_shape_empty;
+    json->val = NULL;
     json->free = 0;
-    json->keys = NULL;
-    json->vals = NULL;
+    json->flags = root == NULL ? 0 : root->flags;
     json->pool = pool;
+    json->root = root == NULL ? json : root;
     json->ref = 1;
+    json->owner = 0;
+    json->dict = root == NULL ? NULL : root->dict;
+    json->str = NULL;
+    json->shapes = NULL;
+    json->top = NULL;
     return json;
+}
 
-free:
-    jc_pool_destroy(pool);
-    return NULL;
+jc_json_t *jc_json_create()
+{
+    return jc_json_create_ex(0);
 }
 
-static void __jc_json_cleanup(jc_val_t *val) {
-    size_t i;
+jc_json_t *jc_json_create_ex(int flags)
+{
+    jc_pool_t   *pool;
+    jc_json_t   *json;
 
-    if (val->type == JC_JSON) {
-        jc_json_destroy(val->data.j);
-        return;
+    if ((pool = jc_pool_create(JC_MEMSIZE)) == NULL) {
+        return NULL;
     }
-    if (val->type == JC_ARRAY && val->data.a->size != 0) {
-        jc_type_t type = val->data.a->value[0]->type;
-        if (type == JC_JSON || type == JC_ARRAY) {
-            for (i = 0; i != val->data.a->size; ++i) {
-                __jc_json_cleanup(val->data.a->value[i]);
-            }
-        }
+    if ((json = jc_json_alloc(pool, NULL)) == NULL) {
+        jc_pool_destroy(pool);
+        return NULL;
     }
+    json->owner = 1;
+    json->flags = flags;
+    return json;
 }
 
-void jc_json_destroy(jc_json_t *js)
+jc_json_t *jc_json_create_in(jc_pool_t *pool)
 {
-    size_t      i, j;
-    jc_val_t   *val;
+    assert(pool != NULL);
 
-    if (js == NULL) {
+    return jc_json_alloc(pool, NULL);
+}
+
+static void jc_json_release(void *data)
+{
+    jc_json_destroy(data);
+}
+
+/*
+ * Objects nested in a document live in the pool of its root, so the
+ * whole tree goes with one jc_pool_destroy(). Documents attached by
+ * jc_json_add_json() are released by the cleanups of that pool.
+ * */
+void jc_json_destroy(jc_json_t *js)
+{
+    if (js == NULL || js->root != js) {
+        /* nested objects are freed with their root */
         return;
     }
 
     assert(js->ref > 0);
-    if (--js->ref != 0) {
+    if (--js->ref != 0 || !js->owner) {
+        /* a pool of the caller is left to jc_pool_reset() */
         return;
     }
 
-    for (i = 0; i != js->size; ++i) {
-        val = js->vals[i];
-        __jc_json_cleanup(val);
-    }
     jc_pool_destroy(js->pool);
 }
 
-static int jc_kv_incr(jc_json_t *js)
+/* a shape of its own for js, a copy of its shared one */
+static int jc_json_unshare(jc_json_t *js)
 {
-    jc_key_t   **new_keys;
-    jc_val_t   **new_vals;
-    jc_pool_t   *pool;
+    jc_shape_t  *s, *own;
 
-    assert(js != NULL);
-    assert(js->free == 0);
+    s = js->shape;
+    if (!s->shared) {
+        return 0;
+    }
+    if ((own = jc_pool_alloc(js->pool, sizeof(jc_shape_t))) == NULL) {
+        return -1;
+    }
+    own->size = s->size;
+    own->free = 0;
+    own->key = NULL;
+    own->index = NULL;
+    own->mask = 0;
+    own->sorted = (js->flags & JC_JSON_ORDERED) ? 0 : s->sorted;
+    own->shared = 0;
+    own->hash = 0;
+    own->next = NULL;
+
+    if (s->size != 0) {
+        own->key = jc_pool_alloc(js->pool, s->size * sizeof(jc_key_t *));
+        if (own->key == NULL) {
+            return -1;
+        }
+        memcpy(own->key, s->key, s->size * sizeof(jc_key_t *));
+    }
+    if (s->index != NULL) {
+        own->index = jc_pool_alloc(js->pool, (s->mask + 1) * sizeof(uint32_t));
+        if (own->index == NULL) {
+            return -1;
+        }
+        memcpy(own->index, s->index, (s->mask + 1) * sizeof(uint32_t));
+        own->mask = s->mask;
+    }
+    js->shape = own;
+    return 0;
+}
+
+/* make room for at least n keys, doubling the capacity */
+static int jc_kv_grow(jc_json_t *js, size_t n)
+{
+    size_t       cap, new_cap;
+    jc_key_t   **key;
+    jc_val_t    *val;
+    jc_shape_t  *s;
 
-    pool = js->pool;
-    new_keys = jc_pool_alloc(pool, sizeof(jc_key_t *) * (js->size + JC_INCSTEP));
-    new_vals = jc_pool_alloc(pool, sizeof(jc_val_t *) * (js->size + JC_INCSTEP));
-    if (new_keys == NULL || new_vals == NULL) {
+    if (jc_json_unshare(js) != 0) {
         return -1;
     }
-    memmove(new_keys, js->keys, sizeof(jc_key_t *) * js->size);
-    memmove(new_vals, js->vals, sizeof(jc_val_t *) * js->size);
-    js->keys = new_keys;
-    js->vals = new_vals;
-    js->free += JC_INCSTEP;
+    s = js->shape;
+
+    cap = s->size + s->free;
+    if (n > cap) {
+        new_cap = cap < JC_INCSTEP ? JC_INCSTEP : cap * 2;
+        if (new_cap < n) {
+            new_cap = n;
+        }
+        key = jc_pool_realloc(js->pool, s->key,
+                sizeof(jc_key_t *) * cap, sizeof(jc_key_t *) * new_cap);
+        if (key == NULL) {
+            return -1;
+        }
+        s->key = key;
+        s->free = new_cap - s->size;
+    }
+
+    cap = s->size + js->free;
+    if (n > cap) {
+        new_cap = cap < JC_INCSTEP ? JC_INCSTEP : cap * 2;
+        if (new_cap < n) {
+            new_cap = n;
+        }
+        val = jc_pool_realloc(js->pool, js->val,
+                sizeof(jc_val_t) * cap, sizeof(jc_val_t) * new_cap);
+        if (val == NULL) {
+            return -1;
+        }
+        js->val = val;
+        js->free = new_cap - s->size;
+    }
     return 0;
 }
 
+/*
+ * The order of sorted objects: bytes, then the shorter first. It is
+ * that of strcmp() but for keys with a NUL in them, which strcmp()
+ * would cut there.
+ * */
+static int jc_key_cmp(const char *key, size_t len, jc_key_t *k)
+{
+    int     rc;
+    size_t  n;
+
+    n = jc_str_size(k);
+    if ((rc = memcmp(key, k->body, len < n ? len : n)) != 0) {
+        return rc;
+    }
+    return len < n ? -1 : len > n;
+}
+
 static void jc_kv_insert(jc_json_t *js, jc_key_t *key, jc_val_t *val)
 {
-    size_t   i;
+    size_t       i;
+    jc_shape_t  *s;
 
-    for (i = js->size; i != 0; --i) {
-        if (strcmp(key->body, js->keys[i-1]->body) < 0) {
-            js->keys[i] = js->keys[i-1];
-            js->vals[i] = js->vals[i-1];
+    s = js->shape;
+    for (i = s->size; i != 0; --i) {
+        if (jc_key_cmp(key->body, jc_str_size(key), s->key[i-1]) < 0) {
+            s->key[i] = s->key[i-1];
+            js->val[i] = js->val[i-1];
         } else {
             break;
         }
     }
-    js->keys[i] = key;
-    js->vals[i] = val;
-    ++js->size;
+    s->key[i] = key;
+    js->val[i] = *val;
+    ++s->size;
+    --s->free;
     --js->free;
 }
 
@@ -151,1289 +334,2421 @@ const char *jc_str_body(jc_str_t *s)
     return s->body;
 }
 
-size_t jc_array_size(jc_array_t *jarray)
+jc_type_t jc_val_type(jc_val_t *val)
 {
-    return jarray->size;
+    return (jc_type_t)val->type;
 }
 
-jc_val_t *jc_array_get(jc_array_t *jarray, size_t idx)
+int jc_val_bool(jc_val_t *val)
 {
-    return idx >= jarray->size ? NULL : jarray->value[idx];
+    return val->type == JC_BOOL ? val->data.b : 0;
 }
 
-static int jc_array_incr(jc_array_t *arr, jc_pool_t *pool)
+double jc_val_num(jc_val_t *val)
 {
-    size_t      i;
-    jc_val_t  **v;
-
-    assert(arr->free == 0);
-
-    v = (jc_val_t **)jc_pool_alloc(pool, (arr->size + JC_INCSTEP) * sizeof (jc_val_t *));
-    if (v == NULL) {
-        return -1;
-    }
-
-    for (i = 0; i != arr->size; ++i) {
-        v[i] = arr->value[i];
+    switch (val->type) {
+        case JC_NUM:
+            return val->data.n;
+        case JC_INT:
+            return (double)val->data.i;
+        default:
+            return 0;
     }
-
-    arr->value = v;
-    arr->free = JC_INCSTEP;
-
-    return 0;
 }
 
-static int jc_array_append(jc_array_t *arr, jc_pool_t *pool, jc_val_t *val)
+int64_t jc_val_int(jc_val_t *val)
 {
-    if (arr->size != 0
-            && arr->value[0]->type != val->type)
-    {
-        return -1;
-    }
-
-    if (arr->free == 0
-            && jc_array_incr(arr, pool) == -1)
-    {
-        /* array incr err */
-        return -1;
+    switch (val->type) {
+        case JC_INT:
+            return val->data.i;
+        case JC_NUM:
+            /* out of range conversions are undefined */
+            if (val->data.n > -9223372036854775808.0
+                    && val->data.n < 9223372036854775808.0)
+            {
+                return (int64_t)val->data.n;
+            }
+            return val->data.n < 0 ? INT64_MIN : INT64_MAX;
+        default:
+            return 0;
     }
-
-    arr->value[arr->size] = val;
-    ++arr->size;
-    --arr->free;
-    return 0;
 }
 
-static jc_array_t *jc_array_create(jc_pool_t *pool)
+/* the length of a view or a lazy value, in the 48 bits of ext */
+static size_t jc_val_span_len(jc_val_t *val)
 {
-    jc_array_t  *arr;
+    int     i;
+    size_t  n;
 
-    if ((arr = jc_pool_alloc(pool, sizeof(jc_array_t))) == NULL) {
-        return NULL;
+    for (n = 0, i = 5; i >= 0; --i) {
+        n = n << 8 | (unsigned char)val->ext[i];
     }
-    arr->size = 0;
-    arr->free = 0;
-    arr->value = NULL;
-    return arr;
+    return n;
 }
 
-static int jc_trans_array(jc_json_t *js, int idx)
+const char *jc_val_str(jc_val_t *val, size_t *len)
 {
-    jc_val_t   *val, *new_val;
-    jc_array_t *arr;
-
-    if ((arr = jc_array_create(js->pool)) == NULL) {
-        return -1;
-    }
-    if ((new_val = jc_pool_alloc(js->pool, sizeof(jc_val_t))) == NULL) {
-        return -1;
+    if (val->type != JC_STR) {
+        return NULL;
     }
-    val = js->vals[idx];
+    switch (val->len) {
+        case JC_STR_HEAP:
+            if (len != NULL) {
+                *len = jc_str_size(val->data.s);
+            }
+            return jc_str_body(val->data.s);
 
-    new_val->type = JC_ARRAY;
-    new_val->data.a = arr;
-    js->vals[idx] = new_val;
+        case JC_STR_VIEW:
+            if (len != NULL) {
+                *len = jc_val_span_len(val);
+            }
+            return val->data.v;
 
-    return jc_array_append(arr, js->pool, val);
+        default:
+            if (len != NULL) {
+                *len = JC_STR_INLINE - val->len;
+            }
+            return (const char *)val;
+    }
 }
 
-static int jc_bsearch_key(jc_json_t *js, jc_key_t *key)
+/* point val at the len bytes at s, which are not copied */
+static void jc_val_span(jc_val_t *val, const char *s, size_t len)
 {
-    int      l, r, m, rc;
+    int  i;
 
-    for (l = 0, r = js->size - 1; l <= r; /* void */ ) {
-        m = l + ((r -l) >> 1);
-        rc = strcmp(key->body, js->keys[m]->body);
-        if (rc > 0) {
-            l = m + 1;
-        } else if (rc < 0) {
-            r = m - 1;
-        } else {
-            return m;
-        }
+    val->data.v = s;
+    for (i = 0; i != 6; ++i, len >>= 8) {
+        val->ext[i] = (char)(len & 0xff);
     }
-    return -1;
 }
 
-static int jc_bsearch_str_key(jc_json_t *js, const char *key)
+/* make val the string of len bytes at s */
+static void jc_val_view_str(jc_val_t *val, const char *s, size_t len)
 {
-    int      l, r, m, rc;
-
-    for (l = 0, r = js->size - 1; l <= r; /* void */ ) {
-        m = l + ((r -l) >> 1);
-        rc = strcmp(key, js->keys[m]->body);
-        if (rc > 0) {
-            l = m + 1;
-        } else if (rc < 0) {
-            r = m - 1;
-        } else {
-            return m;
-        }
-    }
-    return -1;
+    val->type = JC_STR;
+    val->len = JC_STR_VIEW;
+    jc_val_span(val, s, len);
 }
 
-static int jc_json_add_kv(jc_json_t *js, jc_key_t *key, jc_val_t *val)
+/*
+ * parse the lazy object or array val, in place, one level deep: the
+ * objects and arrays nested in it are lazy in turn. Return 0 or -1,
+ * and val is left as it was if its text is bad
+ * */
+static int jc_val_load(jc_json_t *root, jc_val_t *val)
 {
-    int idx;
+    ssize_t      n;
+    size_t       len;
+    jc_val_t     v;
+    const char  *p;
 
-    idx = jc_bsearch_key(js, key);
-
-    if (idx == -1) {
-        if (js->free == 0
-                && jc_kv_incr(js) != 0)
-        {
-            return -1;
-        }
-        jc_kv_insert(js, key, val);
+    if (val->len != JC_VAL_LAZY
+            || (val->type != JC_JSON && val->type != JC_ARRAY))
+    {
         return 0;
     }
 
-    /* key exist */
-    if (js->vals[idx]->type == val->type) {
-        if (jc_trans_array(js, idx) != 0) {
-            return -1;
-        }
-        assert(js->vals[idx]->type == JC_ARRAY);
-        return jc_array_append(js->vals[idx]->data.a, js->pool, val);
+    p = val->data.v;
+    len = jc_val_span_len(val);
+    if (val->type == JC_JSON) {
+        n = __jc_json_parse_sub_json(root, p, p + len, &v, NULL, NULL);
+    } else {
+        n = __jc_json_parse_array(root, p, p + len, &v, NULL);
     }
-
-    if (js->vals[idx]->type == JC_ARRAY) {
-        if (js->vals[idx]->data.a->size == 0
-                || js->vals[idx]->data.a->value[0]->type == val->type)
-        {
-            return jc_array_append(js->vals[idx]->data.a, js->pool, val);
-        }
+    if (n != (ssize_t)len) {
+        return -1;
     }
-
-    /* type error */
-    return -1;
+    *val = v;
+    return 0;
 }
 
-static jc_key_t *jc_key(jc_pool_t *pool, const char *key)
+/* make val the short string s of len bytes, stored inline */
+static void jc_val_inline_str(jc_val_t *val, const char *s, size_t len)
 {
-    size_t     key_len, key_size;
-    jc_key_t  *k;
+    assert(len <= JC_STR_INLINE);
 
-    key_len = strlen(key);
-    key_size = jc_align(sizeof(jc_key_t) + key_len + 1);  /* add the teminating zero */
-    k = jc_pool_alloc(pool, key_size);
-    if (k != NULL) {
-        k->size = key_len + 1;
-        k->free = key_size - k->size - sizeof(jc_key_t);
-        strncpy(k->body, key, k->size + k->free);
-    }
-    return k;
+    val->type = JC_STR;
+    memcpy((char *)val, s, len);
+    ((char *)val)[len] = '\0';
+    val->len = (unsigned char)(JC_STR_INLINE - len);
 }
 
-int jc_json_add_num(jc_json_t *js, const char *key, double n)
+/* make val the string s of len bytes */
+static int jc_val_set_str(jc_val_t *val, jc_pool_t *pool, const char *s,
+        size_t len)
 {
-    jc_key_t  *k;
-    jc_val_t  *v;
-    assert(key != NULL);
-
-    if ((k = jc_key(js->pool, key)) == NULL) {
-        return -1;
+    if (len <= JC_STR_INLINE) {
+        jc_val_inline_str(val, s, len);
+        return 0;
     }
-    v = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-    v->type = JC_NUM;
-    v->data.n = n;
 
-    return jc_json_add_kv(js, k, v);
+    val->type = JC_STR;
+    val->len = JC_STR_HEAP;
+    val->data.s = jc_key_n(pool, s, len);
+    return val->data.s == NULL ? -1 : 0;
 }
 
-int jc_json_add_bool(jc_json_t *js, const char *key, int bl)
+/* make val the string str, got from pool, moved inline if it is short */
+static void jc_val_take_str(jc_val_t *val, jc_pool_t *pool, jc_str_t *str)
 {
-    jc_key_t  *k;
-    jc_val_t  *v;
+    size_t  len;
 
-    assert(key != NULL);
-
-    if ((k = jc_key(js->pool, key)) == NULL) {
-        return -1;
+    len = jc_str_size(str);
+    if (len > JC_STR_INLINE) {
+        val->type = JC_STR;
+        val->len = JC_STR_HEAP;
+        val->data.s = str;
+        return;
     }
-    v = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-    v->type = JC_BOOL;
-    v->data.b = (short)(bl != 0);
 
-    return jc_json_add_kv(js, k, v);
+    jc_val_inline_str(val, str->body, len);
+    jc_pool_free(pool, str, sizeof(jc_str_t) + str->size + str->free);
 }
 
-int jc_json_add_null(jc_json_t *js, const char *key)
+jc_array_t *jc_val_array(jc_val_t *val)
 {
-    jc_key_t  *k;
-    jc_val_t  *v;
-
-    assert(key != NULL);
+    return val->type == JC_ARRAY ? val->data.a : NULL;
+}
 
-    if ((k = jc_key(js->pool, key)) == NULL) {
-        return -1;
-    }
-    v = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-    v->type = JC_NULL;
+jc_json_t *jc_val_json(jc_val_t *val)
+{
+    return val->type == JC_JSON ? val->data.j : NULL;
+}
 
-    return jc_json_add_kv(js, k, v);
+size_t jc_array_size(jc_array_t *jarray)
+{
+    return jarray->size;
 }
 
-int jc_json_add_str(jc_json_t *js, const char *key, const char *val)
+/* the bits of the integers among the packed numbers of arr */
+static unsigned char *jc_array_ints(jc_array_t *arr)
 {
-    jc_key_t  *k;
-    jc_val_t  *v;
+    return (unsigned char *)arr->data
+        + (arr->size + arr->free) * sizeof(double);
+}
 
-    assert(key != NULL);
-    assert(val != NULL);
+/* the packed number i of a JC_PACK_F64 arr was a JC_INT */
+static int jc_array_is_int(jc_array_t *arr, size_t i)
+{
+    return jc_array_ints(arr)[i / 8] >> (i % 8) & 1;
+}
 
-    if ((k = jc_key(js->pool, key)) == NULL) {
-        return -1;
+/* the packed number i of arr as a value */
+static void jc_array_load(jc_array_t *arr, size_t i, jc_val_t *val)
+{
+    if (arr->pack == JC_PACK_F64 && jc_array_is_int(arr, i)) {
+        val->type = JC_INT;
+        val->data.i = (int64_t)((double *)arr->data)[i];
+    } else if (arr->pack == JC_PACK_F64) {
+        val->type = JC_NUM;
+        val->data.n = ((double *)arr->data)[i];
+    } else {
+        val->type = JC_INT;
+        val->data.i = ((int64_t *)arr->data)[i];
     }
-    v = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-    v->type = JC_STR;
+}
 
-    /* jc_key() returns jc_str */
-    if ((v->data.s = jc_key(js->pool, val)) == NULL) {
-        return -1;
+/* drop the copy of the packed numbers, before they change */
+static void jc_array_drop_copy(jc_array_t *arr)
+{
+    if (arr->pack != JC_PACK_NONE && arr->value != NULL) {
+        jc_pool_free(arr->pool, arr->value, arr->size * sizeof(jc_val_t));
+        arr->value = NULL;
     }
-
-    return jc_json_add_kv(js, k, v);
 }
 
-int jc_json_add_array(jc_json_t *js, const char *key)
+jc_val_t *jc_array_get(jc_array_t *jarray, size_t idx)
 {
-    jc_key_t  *k;
+    size_t     i;
     jc_val_t  *v;
 
-    assert(key != NULL);
+    if (idx >= jarray->size) {
+        return NULL;
+    }
 
-    if ((k = jc_key(js->pool, key)) == NULL) {
-        return -1;
+    if (jarray->pack != JC_PACK_NONE && jarray->value == NULL) {
+        v = jc_pool_alloc(jarray->pool, jarray->size * sizeof(jc_val_t));
+        if (v == NULL) {
+            return NULL;
+        }
+        for (i = 0; i != jarray->size; ++i) {
+            jc_array_load(jarray, i, &v[i]);
+        }
+        jarray->value = v;
     }
-    v = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-    v->type = JC_ARRAY;
-    if ((v->data.a = jc_array_create(js->pool)) == NULL) {
-        return -1;
+    if (jc_val_load(jarray->root, &jarray->value[idx]) != 0) {
+        return NULL;
     }
-
-    return jc_json_add_kv(js, k, v);
+    return &jarray->value[idx];
 }
 
-int jc_json_add_json(jc_json_t *js, const char *key, jc_json_t *sub_js)
+/* make room for at least n values, doubling the capacity */
+static int jc_array_grow(jc_array_t *arr, size_t n)
 {
-    jc_key_t  *k;
-    jc_val_t  *v;
-
-    assert(key != NULL);
-    assert(sub_js != NULL);
+    size_t   cap, new_cap, elt, bits;
+    void    *v;
 
-    /* reject self added */
-    if (js == sub_js) {
-        return -1;
+    cap = arr->size + arr->free;
+    if (n <= cap) {
+        return 0;
+    }
+    new_cap = cap < JC_INCSTEP ? JC_INCSTEP : cap * 2;
+    if (new_cap < n) {
+        new_cap = n;
     }
 
-    if ((k = jc_key(js->pool, key)) == NULL) {
+    if (arr->pack == JC_PACK_NONE) {
+        elt = sizeof(jc_val_t);
+        v = jc_pool_realloc(arr->pool, arr->value, cap * elt, new_cap * elt);
+    } else {
+        v = jc_pool_realloc(arr->pool, arr->data, jc_pack_size(cap),
+                jc_pack_size(new_cap));
+    }
+    if (v == NULL) {
         return -1;
     }
-    v = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-    v->type = JC_JSON;
-    v->data.j = sub_js;
 
-    if (jc_json_add_kv(js, k, v) == 0) {
-        sub_js->ref++;
-        return 0;
+    if (arr->pack == JC_PACK_NONE) {
+        arr->value = v;
+    } else {
+        /* the bits move up behind the numbers, the new ones are clear */
+        bits = (cap + 7) / 8;
+        memmove((char *)v + new_cap * sizeof(double),
+                (char *)v + cap * sizeof(double), bits);
+        memset((char *)v + new_cap * sizeof(double) + bits, 0,
+                (new_cap + 7) / 8 - bits);
+        arr->data = v;
     }
-    return -1;
+    arr->free = new_cap - arr->size;
+
+    return 0;
 }
 
-static size_t __jc_json_array_size(jc_array_t *arr)
+/* an empty array is packed if its first value is a number */
+static int jc_array_pack(jc_array_t *arr, jc_type_t type)
 {
-    size_t   s, i;
+    size_t  cap;
 
-    s = sizeof("[]") - 1;
-    for (i = 0; i != arr->size; ++i) {
-        s += __jc_json_val_size(arr->value[i]);
-        if (i != arr->size - 1) {
-            s += sizeof(",") - 1;
-        }
+    if (type != JC_NUM && type != JC_INT) {
+        return 0;
     }
-    return s;
+
+    /* the room reserved for values is kept for numbers */
+    cap = arr->free;
+    jc_pool_free(arr->pool, arr->value, cap * sizeof(jc_val_t));
+    arr->value = NULL;
+    arr->free = 0;
+    arr->pack = type == JC_NUM ? JC_PACK_F64 : JC_PACK_I64;
+    return jc_array_grow(arr, cap);
 }
 
-static size_t __jc_json_val_size(jc_val_t *val)
+/* the packed numbers become values, for a value they cannot hold */
+static int jc_array_unpack(jc_array_t *arr)
 {
-    char    ch, f[512];
-    size_t  s, i;
-    double  a, inta, gap;
+    size_t     i, cap;
+    jc_val_t  *v;
 
-    s = 0;
+    jc_array_drop_copy(arr);
 
-    switch (val->type) {
-        case JC_BOOL:
-            s += sizeof("false") - 1;
-            break;
-        case JC_NUM:
-            a = val->data.n;
-            inta = (double)((int)a);
-            gap = a > inta ? a - inta : inta - a;
-            gap = gap < 0.5 ? gap : 1.0 - gap;
-
-            /* use snprintf to calc the size of double */
-            if (gap < JC_MICRO) {
-                s += snprintf(f, 511, "%d", (int)a);
-            } else {
-                s += snprintf(f, 511, "%f", a);
-            }
-            break;
-        case JC_STR:
-            s += val->data.s->size + sizeof("\"\"") - 1;
-            for (i = 0; i != val->data.s->size; i++) {
-                ch = val->data.s->body[i];
-                if (ch == '\0') {
-                    break;
-                }
-                if (ch == '\"' || ch == '\\' || ch == '/' || ch == '\b' || ch == '\f'
-                        || ch == '\n' || ch == '\r' || ch == '\t')
-                {
-                    ++s;
-                }
-            }
-            break;
-        case JC_ARRAY:
-            s += __jc_json_array_size(val->data.a);
-            break;
-        case JC_JSON:
-            s += __jc_json_size(val->data.j);
-            break;
-        case JC_NULL:
-            s += sizeof("null") - 1;
-            break;
-        default:
-            /* some error happends! */
-            assert(0);
+    cap = arr->size + arr->free;
+    if ((v = jc_pool_alloc(arr->pool, cap * sizeof(jc_val_t))) == NULL) {
+        return -1;
     }
-
-    return s;
+    for (i = 0; i != arr->size; ++i) {
+        jc_array_load(arr, i, &v[i]);
+    }
+    jc_pool_free(arr->pool, arr->data, jc_pack_size(cap));
+    arr->data = NULL;
+    arr->value = v;
+    arr->pack = JC_PACK_NONE;
+    return 0;
 }
 
-static size_t __jc_json_size(jc_json_t *js)
+/*
+ * packed integers become doubles for a JC_NUM, if they all convert;
+ * packed numbers become values for anything else
+ * */
+static int jc_array_repack(jc_array_t *arr, jc_val_t *val)
 {
-    char    ch;
-    size_t  s, i, j;
+    size_t          i;
+    int64_t        *ip;
+    double         *dp;
+    unsigned char  *ints;
 
-    s = sizeof("{}");
-    for (i = 0; i != js->size; ++i) {
-
-        /* key size without teminating '\0' and "": */
-        s += (js->keys[i]->size - 1) + (sizeof("\"\":") - 1);
-        for (j = 0; j != js->keys[i]->size-1; j++) {
-            ch = js->keys[i]->body[j];
-            if (ch == '\0') {
-                break;
-            }
-            if (ch == '\"' || ch == '\\' || ch == '/' || ch == '\b' 
-                    || ch == '\f' || ch == '\n' || ch == '\r' || ch == '\t')
-            {
-                ++s;
-            }
+    if (arr->pack != JC_PACK_NONE && jc_json_type(val->type) != JC_NUM) {
+        return jc_array_unpack(arr);
+    }
+    if (arr->pack == JC_PACK_F64) {
+        if (val->type == JC_INT && !jc_f64_exact(val->data.i)) {
+            return jc_array_unpack(arr);
         }
+        return 0;
+    }
+    if (arr->pack == JC_PACK_NONE || val->type == JC_INT) {
+        return 0;
+    }
 
-        /* value size */
-        s += __jc_json_val_size(js->vals[i]);
-
-        if (i != js->size - 1) {
-            /* add the length of separator of ',' */
-            s += sizeof(",") - 1;
+    ip = arr->data;
+    for (i = 0; i != arr->size; ++i) {
+        if (!jc_f64_exact(ip[i])) {
+            return jc_array_unpack(arr);
         }
     }
-    return s;
+    jc_array_drop_copy(arr);
+    dp = arr->data;
+    ints = jc_array_ints(arr);
+    for (i = 0; i != arr->size; ++i) {
+        dp[i] = (double)ip[i];
+        ints[i / 8] |= 1 << (i % 8);
+    }
+    arr->pack = JC_PACK_F64;
+    return 0;
 }
 
-static int __jc_json_value(jc_val_t *val, char *p)
+static int jc_array_append(jc_array_t *arr, jc_val_t *val)
 {
-    char         ch;
-    double       a, inta, gap;
-    size_t       i;
-    const char  *base;
-
-    base = p;
+    if (arr->size == 0) {
+        if (jc_array_pack(arr, val->type) != 0) {
+            return -1;
+        }
+        arr->type = jc_json_type(val->type);
+    } else {
+        if (jc_array_repack(arr, val) != 0) {
+            return -1;
+        }
+        if (arr->type != jc_json_type(val->type)) {
+            arr->type = JC_MIXED;
+        }
+    }
 
-    switch (val->type) {
-        case JC_BOOL:
-            if (val->data.b) {
-                p[0] = 't';
-                p[1] = 'r';
-                p[2] = 'u';
-                p[3] = 'e';
-                p += 4;
-            } else {
-                p[0] = 'f';
-                p[1] = 'a';
-                p[2] = 'l';
-                p[3] = 's';
-                p[4] = 'e';
-                p += 5;
-            }
-            break;
+    if (arr->free == 0
+            && jc_array_grow(arr, arr->size + 1) == -1)
+    {
+        /* array incr err */
+        return -1;
+    }
 
-        case JC_NUM:
-            a = val->data.n;
-            inta = (double)((int)a);
-            gap = a > inta ? a - inta : inta - a; // for now, 0.0 <= gap <= 0.9999999+
-            gap = gap < 0.5 ? gap : 1.0 - gap;
-            if (gap < JC_MICRO) {
-                p += sprintf(p, "%d", (int)a);
+    switch (arr->pack) {
+        case JC_PACK_F64:
+            jc_array_drop_copy(arr);
+            if (val->type == JC_INT) {
+                ((double *)arr->data)[arr->size] = (double)val->data.i;
+                jc_array_ints(arr)[arr->size / 8] |= 1 << (arr->size % 8);
             } else {
-                p += sprintf(p, "%f", a);
-            }
-            break;
-
-        case JC_STR:
-            *p++ = '\"';
-            for (i = 0; i != val->data.s->size; ++i) {
-                ch = val->data.s->body[i];
-                switch (ch) {
-                    case '\0':
-                        goto end_str_val;
-                    case '\"':
-                        *p++ = '\\';
-                        *p++ = '\"';
-                        break;
-                    case '\\':
-                        *p++ = '\\';
-                        *p++ = '\\';
-                        break;
-                    case '/':
-                        *p++ = '\\';
-                        *p++ = '/';
-                        break;
-                    case '\b':
-                        *p++ = '\\';
-                        *p++ = 'b';
-                        break;
-                    case '\f':
-                        *p++ = '\\';
-                        *p++ = 'f';
-                        break;
-                    case '\n':
-                        *p++ = '\\';
-                        *p++ = 'n';
-                        break;
-                    case '\r':
-                        *p++ = '\\';
-                        *p++ = 'r';
-                        break;
-                    case '\t':
-                        *p++ = '\\';
-                        *p++ = 't';
-                        break;
-                    default:
-                        *p++ = ch;
-                }
+                ((double *)arr->data)[arr->size] = val->data.n;
             }
-end_str_val:
-            *p++ = '\"';
             break;
-
-        case JC_ARRAY:
-            *p++ = '[';
-            for (i = 0; i != val->data.a->size; ++i) {
-                p += __jc_json_value(val->data.a->value[i], p);
-                if (i != val->data.a->size - 1) {
-                    *p++ = ',';
-                }
-            }
-            *p++ = ']';
+        case JC_PACK_I64:
+            jc_array_drop_copy(arr);
+            ((int64_t *)arr->data)[arr->size] = val->data.i;
             break;
+        default:
+            arr->value[arr->size] = *val;
+    }
+    ++arr->size;
+    --arr->free;
+    return 0;
+}
 
-        case JC_JSON:
-            p += __jc_json_str(val->data.j, p);
-            break;
+const double *jc_array_data_f64(jc_array_t *jarray)
+{
+    return jarray->pack == JC_PACK_F64 ? jarray->data : NULL;
+}
 
-        case JC_NULL:
-            p[0] = 'n';
-            p[1] = 'u';
-            p[2] = 'l';
-            p[3] = 'l';
-            p += 4;
-            break;
+const int64_t *jc_array_data_i64(jc_array_t *jarray)
+{
+    return jarray->pack == JC_PACK_I64 ? jarray->data : NULL;
+}
 
-        default:
-            /* some error happens */
-            assert(0);
+int jc_array_sum(jc_array_t *jarray, double *sum)
+{
+    size_t  i;
+    double  s;
+
+    switch (jarray->pack) {
+        case JC_PACK_F64:
+            *sum = jc_sum_f64(jarray->data, jarray->size);
+            return 0;
+        case JC_PACK_I64:
+            *sum = (double)jc_sum_i64(jarray->data, jarray->size);
+            return 0;
     }
 
-    return (int)(p - base);
+    if (jarray->size != 0 && jarray->type != JC_NUM) {
+        return -1;
+    }
+    for (s = 0, i = 0; i != jarray->size; ++i) {
+        s += jc_val_num(&jarray->value[i]);
+    }
+    *sum = s;
+    return 0;
 }
 
-static int __jc_json_str(jc_json_t *js, char *p)
+/* the min (dir < 0) or max (dir > 0) of a non empty array of numbers */
+static int jc_array_bound(jc_array_t *arr, int dir, double *out)
 {
-    char         ch;
-    size_t       i, j;
-    jc_val_t    *val;
-    const char  *base;
-
-    base = p;
-    *p++ = '{';
-    for (i = 0; i != js->size; ++i) {
-        /* print key */
-        *p++ = '\"';
-        for (j = 0; j != js->keys[i]->size; ++j) {
-            ch = js->keys[i]->body[j];
-            switch (ch) {
-                case '\0':
-                    goto end_str;
-                case '\"':
-                    *p++ = '\\';
-                    *p++ = '\"';
-                    break;
-                case '\\':
-                    *p++ = '\\';
-                    *p++ = '\\';
-                    break;
-                case '/':
-                    *p++ = '\\';
-                    *p++ = '/';
-                    break;
-                case '\b':
-                    *p++ = '\\';
-                    *p++ = 'b';
-                    break;
-                case '\f':
-                    *p++ = '\\';
-                    *p++ = 'f';
-                    break;
-                case '\n':
-                    *p++ = '\\';
-                    *p++ = 'n';
-                    break;
-                case '\r':
-                    *p++ = '\\';
-                    *p++ = 'r';
-                    break;
-                case '\t':
-                    *p++ = '\\';
-                    *p++ = 't';
-                    break;
-                default:
-                    *p++ = ch;
-            }
-        }
-end_str:
-        *p++ = '\"';
-        *p++ = ':';
+    size_t  i;
+    double  m, n;
+
+    if (arr->size == 0) {
+        return -1;
+    }
 
-        /* print value */
-        p += __jc_json_value(js->vals[i], p);
+    switch (arr->pack) {
+        case JC_PACK_F64:
+            *out = dir < 0 ? jc_min_f64(arr->data, arr->size)
+                : jc_max_f64(arr->data, arr->size);
+            return 0;
+        case JC_PACK_I64:
+            *out = (double)(dir < 0 ? jc_min_i64(arr->data, arr->size)
+                : jc_max_i64(arr->data, arr->size));
+            return 0;
+    }
 
-        if (i != js->size - 1) {
-            *p++ = ',';
+    if (arr->type != JC_NUM) {
+        return -1;
+    }
+    for (m = jc_val_num(&arr->value[0]), i = 1; i != arr->size; ++i) {
+        n = jc_val_num(&arr->value[i]);
+        if (dir < 0 ? n < m : n > m) {
+            m = n;
         }
     }
-    *p++ = '}';
-    return (int)(p - base);
+    *out = m;
+    return 0;
 }
 
-const char *jc_json_str(jc_json_t *js)
+int jc_array_min(jc_array_t *jarray, double *min)
 {
-    return jc_json_str_n(js, NULL);
+    return jc_array_bound(jarray, -1, min);
 }
 
-const char *jc_json_str_n(jc_json_t *js, size_t *len)
+int jc_array_max(jc_array_t *jarray, double *max)
 {
-    size_t      jsize, n;
-    char       *p;
+    return jc_array_bound(jarray, 1, max);
+}
 
-    assert(js != NULL);
+int jc_array_mean(jc_array_t *jarray, double *mean)
+{
+    double  sum;
 
-    jsize = __jc_json_size(js);
-    if ((p = jc_pool_alloc(js->pool, jsize + 1)) == NULL) {
-        return NULL;
+    if (jarray->size == 0 || jc_array_sum(jarray, &sum) != 0) {
+        return -1;
     }
-    n = __jc_json_str(js, p);
-    p[n] = '\0';
+    *mean = sum / jarray->size;
+    return 0;
+}
 
-    if (len != NULL) {
-        *len = n;
-    }
+/* an empty array in the document of js */
+static jc_array_t *jc_array_create(jc_json_t *js)
+{
+    jc_array_t  *arr;
 
-    return p;
+    if ((arr = jc_pool_alloc(js->pool, sizeof(jc_array_t))) == NULL) {
+        return NULL;
+    }
+    arr->size = 0;
+    arr->free = 0;
+    arr->value = NULL;
+    arr->data = NULL;
+    arr->pack = JC_PACK_NONE;
+    arr->type = JC_MIXED;
+    arr->pool = js->pool;
+    arr->root = js->root;
+    return arr;
 }
 
-/* ====================================
- * To parse json string to json object, 
- * We use state mechine. For detail,
- * please see http://www.json.org
- * ==================================== */
+static int jc_trans_array(jc_json_t *js, int idx)
+{
+    jc_val_t   *val;
+    jc_array_t *arr;
 
-typedef enum {
-    JC_NUM_START_SIGN = 0,
-    JC_NUM_START_ZERO,
-    JC_NUM_START_DIG,
-    JC_NUM_INT_DIG,
-    JC_NUM_POINT,
-    JC_NUM_FLT_DIG,
-    JC_NUM_E_SYMBOL,
-    JC_NUM_E_SIGN,
-    JC_NUM_E_DIG
-} jc_num_state_t;
-
-static int __jc_json_parse_number(jc_json_t *js, const char *p, jc_val_t **val)
-{
-    int      n, sign, e_sign, base;
-    int64_t  i_part, e_part;
-    double   f_tmp, f_factor, f_part;
-    double   f_val;
-
-    jc_num_state_t  state;
-
-    sign = e_sign = 0;
-    i_part = e_part = 0;
-    f_part = 0;
-    f_factor = 1;
-
-    if (p[0] == '-') {
-        /* if p[0] == '+': illegal */
-        state = JC_NUM_START_SIGN;
-        sign = 1;
-    } else if (p[0] == '0') {
-        state = JC_NUM_START_ZERO;
-    } else if (p[0] >= '1' && p[0] <= '9') {
-        state = JC_NUM_START_DIG;
-        i_part = p[0] - '0';
-    } else {
+    if ((arr = jc_array_create(js)) == NULL) {
+        return -1;
+    }
+    val = &js->val[idx];
+    if (jc_array_append(arr, val) != 0) {
         return -1;
     }
 
-    for (n = 1; p[n] != '\0'; ++n) {
-        switch (state) {
-            case JC_NUM_START_SIGN:
-                if (p[n] == '0') {
-                    state = JC_NUM_START_ZERO;
-                } else if (p[n] >= '1' && p[n] <= '9') {
-                    state = JC_NUM_START_DIG;
-                    i_part = p[n] - '0';
-                } else {
-                    return -1;
-                }
-                break;
-
-            case JC_NUM_START_ZERO:
-                if (p[n] == '.') {
-                    state = JC_NUM_POINT;
-                } else if (p[n] == 'e' || p[n] == 'E') {
-                    state = JC_NUM_E_SYMBOL;
-                } else {
-                    goto calc;
-                }
-                break;
+    val->type = JC_ARRAY;
+    val->len = 0;
+    val->data.a = arr;
+    return 0;
+}
 
-            case JC_NUM_START_DIG:
-                if (p[n] >= '0' && p[n] <= '9') {
-                    state = JC_NUM_INT_DIG;
-                    i_part *= 10;
-                    i_part += p[n] - '0';
-                } else if (p[n] == '.') {
-                    state = JC_NUM_POINT;
-                } else if (p[n] == 'e' || p[n] == 'E') {
-                    state = JC_NUM_E_SYMBOL;
-                } else {
-                    goto calc;
-                }
-                break;
+/*
+ * Objects of fewer than JC_HASH_MIN keys stay sorted and are searched
+ * by bisection. Past that an open addressing index is built, new keys
+ * are appended and the keys are sorted again only when they are walked
+ * in order, by jc_json_get_key() or the serializer.
+ *
+ * With JC_JSON_ORDERED keys are always appended and never sorted;
+ * small objects are searched by a linear scan instead.
+ * */
+#define JC_HASH_MIN 16
+
+static void jc_index_put(jc_shape_t *s, size_t idx)
+{
+    size_t  i;
 
-            case JC_NUM_INT_DIG:
-                if (p[n] >= '0' && p[n] <= '9') {
-                    i_part *= 10;
-                    i_part += p[n] - '0';
-                } else if (p[n] == '.') {
-                    state = JC_NUM_POINT;
-                } else if (p[n] == 'e' || p[n] == 'E') {
-                    state = JC_NUM_E_SYMBOL;
-                } else {
-                    goto calc;
-                }
-                break;
+    i = jc_key_hash(s->key[idx]) & s->mask;
+    while (s->index[i] != 0) {
+        i = (i + 1) & s->mask;
+    }
+    s->index[i] = (uint32_t)idx + 1;
+}
 
-            case JC_NUM_POINT:
-                if (p[n] >= '0' && p[n] <= '9') {
-                    f_factor *= 0.1;
-                    f_tmp = f_factor * (p[n] - '0');
-                    f_part += f_tmp;
-                    state = JC_NUM_FLT_DIG;
-                } else {
-                    return -1;
-                }
-                break;
+/* index all keys in a table of at least twice as many slots */
+static int jc_index_build(jc_shape_t *s, jc_pool_t *pool)
+{
+    size_t  i, slots;
 
-            case JC_NUM_FLT_DIG:
-                if (p[n] >= '0' && p[n] <= '9') {
-                    f_factor *= 0.1;
-                    f_tmp = f_factor * (p[n] - '0');
-                    f_part += f_tmp;
-                    state = JC_NUM_FLT_DIG;
-                } else if (p[n] == 'e' || p[n] == 'E') {
-                    state = JC_NUM_E_SYMBOL;
-                } else {
-                    goto calc;
-                }
-                break;
+    for (slots = JC_HASH_MIN * 2; slots < s->size * 2; slots *= 2) {
+        /* void */
+    }
+    if (slots != s->mask + 1 || s->index == NULL) {
+        jc_pool_free(pool, s->index, (s->mask + 1) * sizeof(uint32_t));
+        s->index = jc_pool_alloc(pool, slots * sizeof(uint32_t));
+        if (s->index == NULL) {
+            return -1;
+        }
+        s->mask = slots - 1;
+    }
+    memset(s->index, 0, slots * sizeof(uint32_t));
 
-            case JC_NUM_E_SYMBOL:
-                if (p[n] == '+') {
-                    state = JC_NUM_E_SIGN;
-                } else if (p[n] == '-') {
-                    e_sign = 1;
-                    state = JC_NUM_E_SIGN;
-                } else if (p[n] >= '0' && p[n] <= '9') {
-                    e_part *= 10;
-                    e_part += (p[n] - '0');
-                    state = JC_NUM_E_DIG;
-                } else {
-                    return -1;
-                }
-                break;
+    for (i = 0; i != s->size; ++i) {
+        jc_index_put(s, i);
+    }
+    return 0;
+}
 
-            case JC_NUM_E_SIGN:
-                if (p[n] >= '0' && p[n] <= '9') {
-                    e_part *= 10;
-                    e_part += (p[n] - '0');
-                    state = JC_NUM_E_DIG;
-                } else {
-                    return -1;
-                }
-                break;
+/*
+ * k is the key of len bytes at key. With a dictionary, ik is its shared
+ * copy or NULL if it has none: an interned k is then equal only to ik,
+ * bytes are compared for the keys the dictionary had no room for.
+ * */
+#define jc_key_eq(k, ik, key, len)                                       \
+    ((k) == (ik)                                                         \
+     || (((ik) == NULL || !jc_str_interned(k))                           \
+         && jc_str_size(k) == (len) && memcmp((k)->body, key, len) == 0))
+
+/* return the position of key in s, or -1 */
+static int jc_kv_find(jc_shape_t *s, const char *key, size_t len,
+        jc_key_t *ik)
+{
+    int        l, r, m, rc;
+    size_t     i;
+    uint32_t   e;
+    jc_key_t  *k;
 
-            case JC_NUM_E_DIG:
-                if (p[n] >= '0' && p[n] <= '9') {
-                    e_part *= 10;
-                    e_part += (p[n] - '0');
-                } else {
-                    goto calc;
-                }
-                break;
+    if (s->index != NULL) {
+        i = ik != NULL ? jc_str_hash(ik) : jc_hash(key, len);
+        for (i &= s->mask; (e = s->index[i]) != 0;
+                i = (i + 1) & s->mask)
+        {
+            k = s->key[e - 1];
+            if (jc_key_eq(k, ik, key, len)) {
+                return (int)e - 1;
+            }
         }
-    }
-
-calc:
-    *val = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-    if (*val == NULL) {
         return -1;
     }
 
-    /* double */
-    f_val = i_part + f_part;
-    if (sign != 0) {
-        f_val = -f_val;
+    if (ik != NULL || !s->sorted) {
+        for (i = 0; i != s->size; ++i) {
+            k = s->key[i];
+            if (jc_key_eq(k, ik, key, len)) {
+                return (int)i;
+            }
+        }
+        return -1;
     }
 
-    for (f_factor = 1, base = 1; e_part != 0; e_part >>= 1) {
-        base *= 10;
-        if (e_part & 0x1) {
-            f_factor *= base;
+    for (l = 0, r = s->size - 1; l <= r; /* void */ ) {
+        m = l + ((r -l) >> 1);
+        rc = jc_key_cmp(key, len, s->key[m]);
+        if (rc > 0) {
+            l = m + 1;
+        } else if (rc < 0) {
+            r = m - 1;
+        } else {
+            return m;
         }
     }
+    return -1;
+}
 
-    (*val)->type = JC_NUM;
-    (*val)->data.n = (e_sign == 0 ? f_val * f_factor : f_val / f_factor);
-    return n;
+static int jc_kv_cmp(const void *a, const void *b)
+{
+    jc_key_t  *k = ((const jc_kv_t *)a)->key;
+
+    return jc_key_cmp(k->body, jc_str_size(k), ((const jc_kv_t *)b)->key);
 }
 
-static int __jc_json_parse_bool(jc_json_t *js, const char *p, jc_val_t **val)
+/* put the keys of a hashed object back in order */
+static int jc_json_sort(jc_json_t *js)
 {
-    jc_bool_t  b;
+    size_t       i;
+    jc_kv_t     *kv;
+    jc_shape_t  *s;
 
-    if (p[0] == 't' && p[1] == 'r' && p[2] == 'u' && p[3] == 'e') {
-        b = 1;
-    } else if (p[0] == 'f' && p[1] == 'a' && p[2] == 'l' 
-            && p[3] == 's' && p[4] == 'e')
-    {
-        b = 0;
-    } else {
-        return -1;
+    s = js->shape;
+    if (s->sorted || (js->flags & JC_JSON_ORDERED)) {
+        return 0;
     }
+    assert(!s->shared);
 
-    *val = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-    if (*val == NULL) {
+    /* keys and values move together */
+    if ((kv = malloc(s->size * sizeof(jc_kv_t))) == NULL) {
         return -1;
     }
-    (*val)->type = JC_BOOL;
-    (*val)->data.b = b;
-    return b == 1 ? 4 : 5;
+    for (i = 0; i != s->size; ++i) {
+        kv[i].key = s->key[i];
+        kv[i].val = js->val[i];
+    }
+    qsort(kv, s->size, sizeof(jc_kv_t), jc_kv_cmp);
+    for (i = 0; i != s->size; ++i) {
+        s->key[i] = kv[i].key;
+        js->val[i] = kv[i].val;
+    }
+    free(kv);
+
+    s->sorted = 1;
+    return jc_index_build(s, js->pool);
 }
 
-static int __jc_json_parse_null(jc_json_t *js, const char *p, jc_val_t **val)
+static int jc_json_add_kv(jc_json_t *js, jc_key_t *key, jc_val_t *val)
 {
-    if (p[0] == 'n' && p[1] == 'u' && p[2] == 'l' && p[3] == 'l') {
-        *val = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-        if (*val == NULL) {
+    int          idx;
+    jc_val_t    *old;
+    jc_shape_t  *s;
+
+    if (!jc_json_is_obj(js)) {
+        /* an array or a scalar at the top */
+        return -1;
+    }
+
+    idx = jc_kv_find(js->shape, key->body, jc_str_size(key),
+            jc_str_interned(key) ? key : NULL);
+
+    if (idx == -1) {
+        s = js->shape;
+        if ((s->shared || s->free == 0 || js->free == 0)
+                && jc_kv_grow(js, s->size + 1) != 0)
+        {
             return -1;
         }
-        (*val)->type = JC_NULL;
-        return 4;   /* strlen("null") */
-    }
-    return -1;
-}
+        s = js->shape;
+        if (s->index == NULL && s->sorted) {
+            jc_kv_insert(js, key, val);
+            return s->size < JC_HASH_MIN ? 0 : jc_index_build(s, js->pool);
+        }
 
-static int __jc_json_parse_str(jc_json_t *js, const char *p, jc_val_t **val)
-{
-    int         n;
-    jc_str_t   *str;
+        s->key[s->size] = key;
+        js->val[s->size] = *val;
+        ++s->size;
+        --s->free;
+        --js->free;
 
-    n = __jc_json_parse_key(js, p, &str);
-    if (n < 0) {
-        return -1;
+        if (s->index == NULL) {
+            return s->size < JC_HASH_MIN ? 0 : jc_index_build(s, js->pool);
+        }
+        s->sorted = 0;
+        if (s->size * 2 > s->mask + 1) {
+            return jc_index_build(s, js->pool);
+        }
+        jc_index_put(s, s->size - 1);
+        return 0;
     }
-    *val = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-    if (*val == NULL) {
+
+    /* key exist, its values are gathered in an array */
+    old = &js->val[idx];
+    if (jc_val_load(js->root, old) != 0) {
         return -1;
     }
-    (*val)->type = JC_STR;
-    (*val)->data.s = str;
-    return n;
+    if (old->type != JC_ARRAY || val->type == JC_ARRAY) {
+        if (jc_trans_array(js, idx) != 0) {
+            return -1;
+        }
+    }
+    return jc_array_append(old->data.a, val);
 }
 
-typedef enum {
-    JC_ARR_START = 0,
-    JC_ARR_VAL,
-    JC_ARR_COMMA,
-    JC_ARR_END
-} jc_arr_state_t;
+/*
+ * Shapes are shared within one document, by objects of at most
+ * JC_SHAPE_MAX keys: wider ones are seldom alike.
+ * */
+#define JC_SHAPE_MAX     256
+#define JC_SHAPE_BUCKETS 64
 
-static int __jc_json_parse_array(jc_json_t *js, const char *p, jc_val_t **val)
+static uint32_t jc_shape_hash(jc_shape_t *s)
 {
-    int              n, inc;
-    jc_val_t        *arr_val;
-    jc_array_t      *arr;
-    jc_arr_state_t   state;
+    size_t    i;
+    uint32_t  h;
 
-    if ((arr = jc_array_create(js->pool)) == NULL) {
-        return -1;
+    for (h = (uint32_t)s->size, i = 0; i != s->size; ++i) {
+        h = h * 31 + jc_key_hash(s->key[i]);
     }
+    return h;
+}
+
+/* the same keys in the same order */
+static int jc_shape_eq(jc_shape_t *a, jc_shape_t *b)
+{
+    size_t     i;
+    jc_key_t  *x, *y;
+
+    if (a->size != b->size) {
+        return 0;
+    }
+    for (i = 0; i != a->size; ++i) {
+        x = a->key[i];
+        y = b->key[i];
+        if (x == y) {
+            continue;
+        }
+        if ((jc_str_interned(x) && jc_str_interned(y))
+                || x->size != y->size
+                || memcmp(x->body, y->body, x->size) != 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static jc_shape_t *jc_shapes_find(jc_shapes_t *c, jc_shape_t *s,
+        uint32_t hash)
+{
+    jc_shape_t  *x;
+
+    for (x = c->bucket[hash & c->mask]; x != NULL; x = x->next) {
+        if (x->hash == hash && jc_shape_eq(x, s)) {
+            return x;
+        }
+    }
+    return NULL;
+}
+
+static int jc_shapes_add(jc_shapes_t *c, jc_pool_t *pool, jc_shape_t *s)
+{
+    size_t        i, n;
+    jc_shape_t  **bucket, *x, *next;
+
+    if (c->size >= (c->mask + 1) * 2) {
+        n = (c->mask + 1) * 2;
+        if ((bucket = jc_pool_alloc(pool, n * sizeof(jc_shape_t *))) == NULL) {
+            return -1;
+        }
+        memset(bucket, 0, n * sizeof(jc_shape_t *));
+        for (i = 0; i <= c->mask; ++i) {
+            for (x = c->bucket[i]; x != NULL; x = next) {
+                next = x->next;
+                x->next = bucket[x->hash & (n - 1)];
+                bucket[x->hash & (n - 1)] = x;
+            }
+        }
+        jc_pool_free(pool, c->bucket, (c->mask + 1) * sizeof(jc_shape_t *));
+        c->bucket = bucket;
+        c->mask = n - 1;
+    }
+
+    s->next = c->bucket[s->hash & c->mask];
+    c->bucket[s->hash & c->mask] = s;
+    ++c->size;
+    return 0;
+}
+
+static jc_shapes_t *jc_shapes_create(jc_pool_t *pool)
+{
+    jc_shapes_t  *c;
+
+    if ((c = jc_pool_alloc(pool, sizeof(jc_shapes_t))) == NULL) {
+        return NULL;
+    }
+    c->bucket = jc_pool_alloc(pool, JC_SHAPE_BUCKETS * sizeof(jc_shape_t *));
+    if (c->bucket == NULL) {
+        return NULL;
+    }
+    memset(c->bucket, 0, JC_SHAPE_BUCKETS * sizeof(jc_shape_t *));
+    c->mask = JC_SHAPE_BUCKETS - 1;
+    c->size = 0;
+    return c;
+}
+
+/*
+ * js was just parsed: take the shape of an object of the document with
+ * the same keys, hint first, or offer its own for sharing. Keys of js
+ * may be those of hint; its own copies go back to the pool.
+ * */
+static int jc_json_seal(jc_json_t *js, jc_shape_t *hint)
+{
+    size_t        i;
+    uint32_t      h;
+    jc_key_t     *k;
+    jc_shape_t   *s, *found;
+    jc_json_t    *root;
+
+    s = js->shape;
+    if (s->shared || s->size > JC_SHAPE_MAX) {
+        return 0;
+    }
+    if (jc_json_sort(js) != 0) {
+        return -1;
+    }
+
+    /* parsed objects seldom grow */
+    js->val = jc_pool_realloc(js->pool, js->val,
+            (s->size + js->free) * sizeof(jc_val_t),
+            s->size * sizeof(jc_val_t));
+    js->free = 0;
+
+    h = jc_shape_hash(s);
+    root = js->root;
+    if (root->shapes == NULL
+            && (root->shapes = jc_shapes_create(root->pool)) == NULL)
+    {
+        return -1;
+    }
+    if (hint != NULL && hint->hash == h && jc_shape_eq(hint, s)) {
+        found = hint;
+    } else {
+        found = jc_shapes_find(root->shapes, s, h);
+    }
+
+    if (found == NULL) {
+        /* final, the spare room goes back */
+        s->key = jc_pool_realloc(js->pool, s->key,
+                (s->size + s->free) * sizeof(jc_key_t *),
+                s->size * sizeof(jc_key_t *));
+        s->free = 0;
+        s->hash = h;
+        s->shared = 1;
+        return jc_shapes_add(root->shapes, root->pool, s);
+    }
+
+    for (i = 0; i != s->size; ++i) {
+        k = s->key[i];
+        if (k != found->key[i] && !jc_str_interned(k)
+                && (hint == NULL || hint == found))
+        {
+            jc_pool_free(js->pool, k, sizeof(jc_key_t) + k->size + k->free);
+        }
+    }
+    jc_pool_free(js->pool, s->index, (s->mask + 1) * sizeof(uint32_t));
+    jc_pool_free(js->pool, s->key, (s->size + s->free) * sizeof(jc_key_t *));
+    jc_pool_free(js->pool, s, sizeof(jc_shape_t));
+    js->shape = found;
+    return 0;
+}
+
+static jc_key_t *jc_key_n(jc_pool_t *pool, const char *key, size_t key_len)
+{
+    size_t     key_size;
+    jc_key_t  *k;
+
+    key_size = jc_align(sizeof(jc_key_t) + key_len + 1);  /* add the teminating zero */
+    k = jc_pool_alloc(pool, key_size);
+    if (k != NULL) {
+        k->size = key_len + 1;
+        k->free = key_size - k->size - sizeof(jc_key_t);
+        memcpy(k->body, key, key_len);
+        k->body[key_len] = '\0';
+    }
+    return k;
+}
+
+/* a key of js, the shared copy if js has a dictionary with room */
+static jc_key_t *jc_json_key(jc_json_t *js, const char *key, size_t len)
+{
+    jc_key_t  *k;
+
+    if (js->dict != NULL) {
+        k = jc_intern_get(js->dict, key, len, jc_hash(key, len));
+        if (k != NULL) {
+            return k;
+        }
+    }
+    return jc_key_n(js->pool, key, len);
+}
+
+static void jc_json_release_intern(void *data)
+{
+    jc_intern_destroy(data);
+}
+
+int jc_json_set_intern(jc_json_t *js, jc_intern_t *dict)
+{
+    jc_pool_cleanup_t  *cln;
+
+    assert(dict != NULL);
+
+    /* every key of a document must come from the same place */
+    if (js->root != js || js->shape->size != 0 || js->dict != NULL) {
+        return -1;
+    }
+    if ((cln = jc_pool_cleanup_add(js->pool)) == NULL) {
+        return -1;
+    }
+    cln->handler = jc_json_release_intern;
+    cln->data = jc_intern_ref(dict);
+    js->dict = dict;
+    return 0;
+}
+
+int jc_json_add_num(jc_json_t *js, const char *key, double n)
+{
+    jc_key_t  *k;
+    jc_val_t   v;
+
+    assert(key != NULL);
+
+    if ((k = jc_json_key(js, key, strlen(key))) == NULL) {
+        return -1;
+    }
+    v.type = JC_NUM;
+    v.data.n = n;
+
+    return jc_json_add_kv(js, k, &v);
+}
+
+int jc_json_add_int(jc_json_t *js, const char *key, int64_t i)
+{
+    jc_key_t  *k;
+    jc_val_t   v;
+
+    assert(key != NULL);
+
+    if ((k = jc_json_key(js, key, strlen(key))) == NULL) {
+        return -1;
+    }
+    v.type = JC_INT;
+    v.data.i = i;
+
+    return jc_json_add_kv(js, k, &v);
+}
+
+int jc_json_add_bool(jc_json_t *js, const char *key, int bl)
+{
+    jc_key_t  *k;
+    jc_val_t   v;
+
+    assert(key != NULL);
+
+    if ((k = jc_json_key(js, key, strlen(key))) == NULL) {
+        return -1;
+    }
+    v.type = JC_BOOL;
+    v.data.b = (short)(bl != 0);
+
+    return jc_json_add_kv(js, k, &v);
+}
+
+int jc_json_add_null(jc_json_t *js, const char *key)
+{
+    jc_key_t  *k;
+    jc_val_t   v;
+
+    assert(key != NULL);
+
+    if ((k = jc_json_key(js, key, strlen(key))) == NULL) {
+        return -1;
+    }
+    v.type = JC_NULL;
+
+    return jc_json_add_kv(js, k, &v);
+}
+
+int jc_json_add_str(jc_json_t *js, const char *key, const char *val)
+{
+    jc_key_t  *k;
+    jc_val_t   v;
+
+    assert(key != NULL);
+    assert(val != NULL);
+
+    if ((k = jc_json_key(js, key, strlen(key))) == NULL) {
+        return -1;
+    }
+    if (jc_val_set_str(&v, js->pool, val, strlen(val)) != 0) {
+        return -1;
+    }
+
+    return jc_json_add_kv(js, k, &v);
+}
+
+int jc_json_add_array(jc_json_t *js, const char *key)
+{
+    jc_key_t  *k;
+    jc_val_t   v;
+
+    assert(key != NULL);
+
+    if ((k = jc_json_key(js, key, strlen(key))) == NULL) {
+        return -1;
+    }
+    v.type = JC_ARRAY;
+    v.len = 0;
+    if ((v.data.a = jc_array_create(js)) == NULL) {
+        return -1;
+    }
+
+    return jc_json_add_kv(js, k, &v);
+}
+
+int jc_json_add_json(jc_json_t *js, const char *key, jc_json_t *sub_js)
+{
+    jc_key_t           *k;
+    jc_val_t            v;
+    jc_pool_cleanup_t  *cln;
+
+    assert(key != NULL);
+    assert(sub_js != NULL);
+
+    /* reject self added, and documents which are not objects */
+    if (js == sub_js || !jc_json_is_obj(sub_js)) {
+        return -1;
+    }
+
+    if ((k = jc_json_key(js, key, strlen(key))) == NULL) {
+        return -1;
+    }
+    v.type = JC_JSON;
+    v.len = 0;
+    v.data.j = sub_js;
+
+    if (sub_js->root == js->root) {
+        /* same document, same lifetime */
+        return jc_json_add_kv(js, k, &v);
+    }
+
+    /* keep the document of sub_js until js goes */
+    if ((cln = jc_pool_cleanup_add(js->pool)) == NULL) {
+        return -1;
+    }
+    if (jc_json_add_kv(js, k, &v) != 0) {
+        return -1;
+    }
+    cln->handler = jc_json_release;
+    cln->data = sub_js->root;
+    sub_js->root->ref++;
+    return 0;
+}
+
+static int __jc_json_write_val(jc_val_t *val, jc_buf_t *b)
+{
+    int          rc;
+    double       d;
+    size_t       i, len;
+    const char  *str;
+    jc_array_t  *arr;
+
+    switch (val->type) {
+        case JC_BOOL:
+            return val->data.b ? jc_buf_put(b, "true", 4)
+                : jc_buf_put(b, "false", 5);
+
+        case JC_NUM:
+            return jc_buf_put_num(b, val->data.n);
+
+        case JC_INT:
+            return jc_buf_put_int(b, val->data.i);
+
+        case JC_STR:
+            str = jc_val_str(val, &len);
+            return jc_buf_put_str(b, str, len);
+
+        case JC_ARRAY:
+            arr = val->data.a;
+            if ((rc = jc_buf_putc(b, '[')) != 0) {
+                return rc;
+            }
+            for (i = 0; i != arr->size; ++i) {
+                if (i != 0 && (rc = jc_buf_putc(b, ',')) != 0) {
+                    return rc;
+                }
+                switch (arr->pack) {
+                    case JC_PACK_F64:
+                        d = ((double *)arr->data)[i];
+                        rc = jc_array_is_int(arr, i)
+                            ? jc_buf_put_int(b, (int64_t)d)
+                            : jc_buf_put_num(b, d);
+                        break;
+                    case JC_PACK_I64:
+                        rc = jc_buf_put_int(b, ((int64_t *)arr->data)[i]);
+                        break;
+                    default:
+                        if (jc_val_load(arr->root, &arr->value[i]) != 0) {
+                            return -1;
+                        }
+                        rc = __jc_json_write_val(&arr->value[i], b);
+                }
+                if (rc != 0) {
+                    return rc;
+                }
+            }
+            return jc_buf_putc(b, ']');
+
+        case JC_JSON:
+            return __jc_json_write(val->data.j, b);
+
+        case JC_NULL:
+            return jc_buf_put(b, "null", 4);
+
+        default:
+            /* some error happens */
+            assert(0);
+    }
+
+    return -1;
+}
+
+static int __jc_json_write(jc_json_t *js, jc_buf_t *b)
+{
+    int     rc;
+    size_t  i;
+
+    if (!jc_json_is_obj(js)) {
+        if (jc_val_load(js, js->top) != 0) {
+            return -1;
+        }
+        return __jc_json_write_val(js->top, b);
+    }
+
+    if (jc_json_sort(js) != 0) {
+        return -1;
+    }
+    if ((rc = jc_buf_putc(b, '{')) != 0) {
+        return rc;
+    }
+    for (i = 0; i != js->shape->size; ++i) {
+        if (i != 0 && (rc = jc_buf_putc(b, ',')) != 0) {
+            return rc;
+        }
+        rc = jc_buf_put_str(b, js->shape->key[i]->body,
+                jc_str_size(js->shape->key[i]));
+        if (rc != 0 || (rc = jc_buf_putc(b, ':')) != 0) {
+            return rc;
+        }
+        if (jc_val_load(js->root, &js->val[i]) != 0) {
+            return -1;
+        }
+        if ((rc = __jc_json_write_val(&js->val[i], b)) != 0) {
+            return rc;
+        }
+    }
+    return jc_buf_putc(b, '}');
+}
+
+int jc_json_write(jc_json_t *js, jc_buf_t *out)
+{
+    int  rc;
+
+    assert(js != NULL);
+    assert(out != NULL);
+
+    /*
+     * replay from the start, bytes taken by a cut call are skipped;
+     * otherwise a new write, appended to what plain puts left in out
+     * */
+    if (!out->cut) {
+        out->done = 0;
+    }
+    out->pos = 0;
+    rc = __jc_json_write(js, out);
+    out->cut = rc == JC_BUF_FULL;
+    if (!out->cut) {
+        out->pos = 0;
+        out->done = 0;
+    }
+    return rc;
+}
+
+static void jc_json_free_str(void *data)
+{
+    jc_buf_free(data);
+}
+
+const char *jc_json_str(jc_json_t *js)
+{
+    return jc_json_str_n(js, NULL);
+}
+
+const char *jc_json_str_n(jc_json_t *js, size_t *len)
+{
+    jc_pool_cleanup_t  *cln;
+
+    assert(js != NULL);
+
+    /* one buffer per json, reused by every call */
+    if (js->str == NULL) {
+        if ((js->str = jc_pool_alloc(js->pool, sizeof(jc_buf_t))) == NULL) {
+            return NULL;
+        }
+        jc_buf_init(js->str);
+        if ((cln = jc_pool_cleanup_add(js->pool)) == NULL) {
+            return NULL;
+        }
+        cln->handler = jc_json_free_str;
+        cln->data = js->str;
+    }
+
+    jc_buf_reset(js->str);
+    if (jc_json_write(js, js->str) != 0
+            || jc_buf_putc(js->str, '\0') != 0)
+    {
+        return NULL;
+    }
+
+    if (len != NULL) {
+        *len = js->str->len - 1;
+    }
+
+    return js->str->data;
+}
+
+/* ====================================
+ * To parse json string to json object,
+ * We use state mechine. For detail,
+ * please see http://www.json.org
+ *
+ * Every parser below is bounded by `end'
+ * and never reads past it, so the input
+ * does not have to be NUL-terminated.
+ * ==================================== */
+
+#define jc_is_ws(ch) \
+    ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
+
+static const char *jc_skip_ws(const char *p, const char *end)
+{
+    /* most tokens are followed by no whitespace at all */
+    if (p == end || !jc_is_ws(*p)) {
+        return p;
+    }
+    return jc_scan_ws(p + 1, end);
+}
+
+static ssize_t __jc_json_parse_number(const char *p, const char *end,
+        jc_val_t *val)
+{
+    ssize_t      n;
+    jc_number_t  num;
+
+    if ((n = jc_number_parse(p, end, &num)) == -1) {
+        return -1;
+    }
+
+    if (num.is_int) {
+        val->type = JC_INT;
+        val->data.i = num.i;
+    } else {
+        val->type = JC_NUM;
+        val->data.n = num.d;
+    }
+    return n;
+}
+
+static ssize_t __jc_json_parse_bool(const char *p, const char *end,
+        jc_val_t *val)
+{
+    jc_bool_t  b;
+
+    if (end - p >= 4
+            && p[0] == 't' && p[1] == 'r' && p[2] == 'u' && p[3] == 'e')
+    {
+        b = 1;
+    } else if (end - p >= 5
+            && p[0] == 'f' && p[1] == 'a' && p[2] == 'l'
+            && p[3] == 's' && p[4] == 'e')
+    {
+        b = 0;
+    } else {
+        return -1;
+    }
+
+    val->type = JC_BOOL;
+    val->data.b = b;
+    return b == 1 ? 4 : 5;
+}
+
+static ssize_t __jc_json_parse_null(const char *p, const char *end,
+        jc_val_t *val)
+{
+    if (end - p >= 4
+            && p[0] == 'n' && p[1] == 'u' && p[2] == 'l' && p[3] == 'l')
+    {
+        val->type = JC_NULL;
+        return 4;   /* strlen("null") */
+    }
+    return -1;
+}
+
+static ssize_t __jc_json_parse_str(jc_json_t *js, const char *p,
+        const char *end, jc_val_t *val)
+{
+    ssize_t      n;
+    jc_str_t    *str;
+    const char  *q, *r;
+
+    /* a short string without escapes goes straight into val */
+    r = p + 1;
+    q = jc_scan_str(r, end - r > JC_STR_INLINE ? r + JC_STR_INLINE + 1 : end);
+    if (q != end && *q == '\"' && q - r <= JC_STR_INLINE) {
+        jc_val_inline_str(val, r, q - r);
+        return q + 1 - p;
+    }
+
+    if (js->flags & JC_JSON_VIEW) {
+        if (q != end && *q != '\\') {
+            q = jc_scan_str(q, end);
+        }
+        if (q == end) {
+            return -1;
+        }
+        if (*q == '\"') {
+            jc_val_view_str(val, r, q - r);
+            return q + 1 - p;
+        }
+    }
+
+    /* escapes are decoded into a copy */
+    n = __jc_json_parse_key(js, p, end, &str);
+    if (n < 0) {
+        return -1;
+    }
+    jc_val_take_str(val, js->pool, str);
+    return n;
+}
+
+/*
+ * Projection: a jc_path_t node names the parts of a value to keep, and
+ * NULL means all of it. A value of another kind than the node expects
+ * is skipped, like the members and elements it does not name.
+ * */
+#define jc_path_sel(node) ((node)->all ? NULL : (node))
+
+/* path has a member for an object, or the elements for an array, at c */
+static int jc_path_fits(jc_path_t *path, char c)
+{
+    jc_path_t  *n;
+
+    if (path == NULL) {
+        return 1;
+    }
+    for (n = path->child; n != NULL; n = n->next) {
+        if (n->key == NULL ? c == '[' : c == '{') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* pass over the value at p, with no allocation at all */
+static ssize_t __jc_json_skip_val(jc_json_t *js, const char *p,
+        const char *end)
+{
+    jc_val_t     v;
+    const char  *q;
+
+    switch (*p) {
+        case '{':
+        case '[':
+            q = jc_scan_skip(p, end);
+            return q == NULL ? -1 : q - p;
+
+        case '\"':
+            for (q = p + 1; (q = jc_scan_str(q, end)) != end; q += 2) {
+                if (*q == '\"') {
+                    return q + 1 - p;
+                }
+                if (end - q < 2) {
+                    break;
+                }
+            }
+            return -1;
 
-    if (p[0] == '[') {
-        state = JC_ARR_START;
-    } else {
+        default:
+            /* numbers and literals are never copied */
+            return __jc_json_parse_val(js, p, end, &v);
+    }
+}
+
+/* the parts of the value at p named by path, which fits it */
+static ssize_t __jc_json_parse_sel(jc_json_t *js, const char *p,
+        const char *end, jc_val_t *val, jc_path_t *path)
+{
+    if (path == NULL) {
+        return __jc_json_parse_val(js, p, end, val);
+    }
+    if (*p == '{') {
+        return __jc_json_parse_sub_json(js, p, end, val, NULL, path);
+    }
+    return __jc_json_parse_array(js, p, end, val,
+            jc_path_sel(jc_path_find(path, NULL, 0)));
+}
+
+/* path, if not NULL, names the parts of the elements to keep */
+static ssize_t __jc_json_parse_array(jc_json_t *js, const char *p,
+        const char *end, jc_val_t *val, jc_path_t *path)
+{
+    ssize_t          inc;
+    const char      *q;
+    jc_val_t         arr_val;
+    jc_array_t      *arr;
+    jc_shape_t      *hint;
+    jc_arr_state_t   state;
+
+    if (p[0] != '[') {
         return -1;
     }
 
-    for (n = 0; p[n] != '\0'; ++n) {
+    if ((arr = jc_array_create(js)) == NULL) {
+        return -1;
+    }
+
+    hint = NULL;
+
+    for (q = p + 1, state = JC_ARR_START; /* void */ ; /* void */ ) {
+        if ((q = jc_skip_ws(q, end)) == end) {
+            return -1;
+        }
+
         switch (state) {
             case JC_ARR_START:
-                if (p[n+1] == ']') {
+                if (*q == ']') {
                     state = JC_ARR_END;
                 } else {
                     state = JC_ARR_VAL;
                 }
                 break;
-                
+
             case JC_ARR_VAL:
-                inc = __jc_json_parse_val(js, &p[n], &arr_val);
+                if (!jc_path_fits(path, *q)) {
+                    if ((inc = __jc_json_skip_val(js, q, end)) == -1) {
+                        return -1;
+                    }
+                    q += inc;
+                    state = JC_ARR_COMMA;
+                    break;
+                }
+                if (*q == '{' && (path != NULL
+                            || !(js->flags & JC_JSON_LAZY)))
+                {
+                    /* records of an array tend to have the same keys */
+                    inc = __jc_json_parse_sub_json(js, q, end, &arr_val, hint,
+                            path);
+                    if (inc != -1 && arr_val.data.j->shape->shared) {
+                        hint = arr_val.data.j->shape;
+                    }
+                } else {
+                    inc = __jc_json_parse_sel(js, q, end, &arr_val, path);
+                }
                 if (inc == -1) {
                     return -1;
                 }
+                q += inc;
 
-                n += inc;
-                if (p[n] == ',') {
-                    state = JC_ARR_COMMA;
-                } else if (p[n] == ']') {
+                if (jc_array_append(arr, &arr_val) == -1) {
+                    return -1;
+                }
+                state = JC_ARR_COMMA;
+                break;
+
+            case JC_ARR_COMMA:
+                if (*q == ',') {
+                    ++q;
+                    state = JC_ARR_VAL;
+                } else if (*q == ']') {
                     state = JC_ARR_END;
                 } else {
                     return -1;
                 }
-                /* go back 1 char because n will be incr-ed 1 in for-loop */
-                --n;
+                break;
+
+            case JC_ARR_END:
+                val->type = JC_ARRAY;
+                val->len = 0;
+                val->data.a = arr;
+                return q + 1 - p;
+        }
+    }
+}
+
+/* the node of path for the key at p, which is skipped */
+static ssize_t __jc_json_sel_key(jc_json_t *js, const char *p,
+        const char *end, jc_path_t *path, jc_path_t **sel)
+{
+    ssize_t      n;
+    jc_key_t    *k;
+    const char  *q;
+
+    if (p[0] != '\"') {
+        return -1;
+    }
+    q = jc_scan_str(p + 1, end);
+    if (q != end && *q == '\"') {
+        *sel = jc_path_find(path, p + 1, q - p - 1);
+        return q + 1 - p;
+    }
+
+    /* escapes are decoded, into a copy given back at once */
+    if ((n = __jc_json_parse_key(js, p, end, &k)) < 0) {
+        return -1;
+    }
+    *sel = jc_path_find(path, k->body, jc_str_size(k));
+    jc_pool_free(js->pool, k, sizeof(jc_key_t) + k->size + k->free);
+    return n;
+}
+
+/*
+ * parse the object at p into js, return bytes consumed or -1;
+ * hint is the shape js is likely to have, or NULL; path, if not NULL,
+ * names the members to keep
+ * */
+static ssize_t __jc_json_parse_obj(jc_json_t *js, const char *p,
+        const char *end, jc_shape_t *hint, jc_path_t *path)
+{
+    ssize_t          inc;
+    const char      *q, *kp;
+    jc_key_t        *key;
+    jc_val_t         val;
+    jc_path_t       *sel;
+    jc_obj_state_t   state;
+
+    kp = NULL;
+    sel = NULL;
+
+    for (q = p, state = JC_OBJ_START; /* void */ ; /* void */ ) {
+        if ((q = jc_skip_ws(q, end)) == end) {
+            return -1;
+        }
+
+        switch (state) {
+            case JC_OBJ_START:
+                if (*q++ == '{') {
+                    state = JC_OBJ_LBRACE;
+                    break;
+                }
+                return -1;
+
+            case JC_OBJ_LBRACE:
+                if (*q == '}') {
+                    /* empty json, of the empty shape */
+                    return q + 1 - p;
+                } else if (*q == '\"') {
+                    state = JC_OBJ_KEY;
+                } else {
+                    return -1;
+                }
+                break;
+
+            case JC_OBJ_KEY:
+                if (path != NULL) {
+                    /* the key is only built if its value is kept */
+                    kp = q;
+                    inc = __jc_json_sel_key(js, q, end, path, &sel);
+                } else {
+                    inc = __jc_json_parse_name(js, q, end, &key, hint);
+                }
+                if (inc > 0) {
+                    q += inc;
+                    state = JC_OBJ_COLON;
+                    break;
+                }
+                return -1;
+
+            case JC_OBJ_COLON:
+                if (*q++ == ':') {
+                    state = JC_OBJ_VAL;
+                    break;
+                }
+                return -1;
+
+            case JC_OBJ_VAL:
+                if (path == NULL) {
+                    inc = __jc_json_parse_val(js, q, end, &val);
+                } else if (sel == NULL
+                        || !jc_path_fits(jc_path_sel(sel), *q))
+                {
+                    if ((inc = __jc_json_skip_val(js, q, end)) == -1) {
+                        return -1;
+                    }
+                    q += inc;
+                    state = JC_OBJ_COMMA;
+                    break;
+                } else if (__jc_json_parse_name(js, kp, end, &key, hint) > 0) {
+                    inc = __jc_json_parse_sel(js, q, end, &val,
+                            jc_path_sel(sel));
+                } else {
+                    inc = -1;
+                }
+                if (inc == -1) {
+                    return -1;
+                }
+                q += inc;
+                if (jc_json_add_kv(js, key, &val) == -1) {
+                    return -1;
+                }
+                state = JC_OBJ_COMMA;
+                break;
 
-                if (jc_array_append(arr, js->pool, arr_val) == -1) {
+            case JC_OBJ_COMMA:
+                if (*q == ',') {
+                    ++q;
+                    state = JC_OBJ_KEY;
+                } else if (*q == '}') {
+                    /* Accept */
+                    if (jc_json_seal(js, hint) != 0) {
+                        return -1;
+                    }
+                    return q + 1 - p;
+                } else {
                     return -1;
                 }
                 break;
 
-            case JC_ARR_COMMA:
-                state = JC_ARR_VAL;
-                break;
+            default:
+                /* some error happens */
+                assert(0);
+        }
+    }
+}
+
+static ssize_t __jc_json_parse_sub_json(jc_json_t *js, const char *p,
+        const char *end, jc_val_t *js_val, jc_shape_t *hint,
+        jc_path_t *path)
+{
+    ssize_t          n;
+    jc_json_t       *sub_js;
+
+    /* nested objects share the pool of the document */
+    if ((sub_js = jc_json_alloc(js->pool, js->root)) == NULL) {
+        return -1;
+    }
+
+    if ((n = __jc_json_parse_obj(sub_js, p, end, hint, path)) == -1) {
+        return -1;
+    }
+
+    js_val->type = JC_JSON;
+    js_val->len = 0;
+    js_val->data.j = sub_js;
+    return n;
+}
+
+#define JC_STR_GUESS 64
+
+/*
+ * One pass over the string: jc_scan_str() finds the next '"' or '\\',
+ * the plain run before it is copied at once, escapes are decoded inline.
+ * A string without escapes is sized exactly. Otherwise the body grows
+ * at the tail of the pool and is shrunk to fit when the string closes.
+ * */
+static ssize_t __jc_json_parse_key(jc_json_t *js, const char *p,
+        const char *end, jc_key_t **key)
+{
+    int          n;
+    size_t       size, cap, need, used;
+    jc_key_t    *k;
+    const char  *q, *r;
+
+    if (p[0] != '\"') {
+        return -1;
+    }
+
+    r = p + 1;
+    if ((q = jc_scan_str(r, end)) == end) {
+        return -1;
+    }
+    size = q - r;
+
+    if (*q == '\"') {
+        cap = jc_align(sizeof(jc_key_t) + size + 1);
+        if ((k = jc_pool_alloc(js->pool, cap)) == NULL) {
+            return -1;
+        }
+        memcpy(k->body, r, size);
+        goto done;
+    }
+
+    cap = jc_align(sizeof(jc_key_t) + size + JC_STR_GUESS);
+    if ((k = jc_pool_alloc(js->pool, cap)) == NULL) {
+        return -1;
+    }
+    memcpy(k->body, r, size);
+
+    for (r = q; /* void */ ; r = q) {
+        if (*r == '\\') {
+            /* room for one decoded escape and the terminating zero */
+            need = sizeof(jc_key_t) + size + JC_UNESCAPE_MAX + 1;
+            if (need > cap) {
+                k = jc_pool_realloc(js->pool, k, cap, cap * 2 + need);
+                if (k == NULL) {
+                    return -1;
+                }
+                cap = jc_align(cap * 2 + need);
+            }
+            if ((n = jc_unescape(r, end, &k->body[size], &used)) == -1) {
+                return -1;
+            }
+            size += n;
+            r += used;
+        }
+
+        if ((q = jc_scan_str(r, end)) == end) {
+            return -1;
+        }
+
+        need = sizeof(jc_key_t) + size + (q - r) + 1;
+        if (need > cap) {
+            k = jc_pool_realloc(js->pool, k, cap, cap * 2 + need);
+            if (k == NULL) {
+                return -1;
+            }
+            cap = jc_align(cap * 2 + need);
+        }
+        memcpy(&k->body[size], r, q - r);
+        size += q - r;
+
+        if (*q == '\"') {
+            break;
+        }
+    }
+
+    /* give the unused tail back to the pool */
+    need = jc_align(sizeof(jc_key_t) + size + 1);
+    k = jc_pool_realloc(js->pool, k, cap, need);
+    cap = need;
+
+done:
+    k->body[size++] = '\0';
+    k->size = size;
+    k->free = cap - sizeof(jc_key_t) - size;
+    *key = k;
+    return q + 1 - p;
+}
+
+/*
+ * a key of the object js, looked up in place in the shape hint, then
+ * in the dictionary of js if any
+ * */
+static ssize_t __jc_json_parse_name(jc_json_t *js, const char *p,
+        const char *end, jc_key_t **key, jc_shape_t *hint)
+{
+    int          idx;
+    ssize_t      n;
+    jc_key_t    *k, *ik;
+    const char  *q;
+
+    if (hint != NULL && p[0] == '\"') {
+        q = jc_scan_str(p + 1, end);
+        if (q != end && *q == '\"'
+                && (idx = jc_kv_find(hint, p + 1, q - p - 1, NULL)) != -1)
+        {
+            *key = hint->key[idx];
+            return q + 1 - p;
+        }
+    }
+
+    if (js->dict == NULL || p[0] != '\"') {
+        return __jc_json_parse_key(js, p, end, key);
+    }
+
+    q = jc_scan_str(p + 1, end);
+    if (q != end && *q == '\"') {
+        n = q - p - 1;
+        if ((ik = jc_intern_get(js->dict, p + 1, n, jc_hash(p + 1, n)))
+                != NULL)
+        {
+            *key = ik;
+            return q + 1 - p;
+        }
+        return __jc_json_parse_key(js, p, end, key);
+    }
+
+    /* decoded first, the copy goes back to the pool if it is shared */
+    if ((n = __jc_json_parse_key(js, p, end, &k)) < 0) {
+        return -1;
+    }
+    ik = jc_intern_get(js->dict, k->body, jc_str_size(k),
+            jc_hash(k->body, jc_str_size(k)));
+    if (ik == NULL) {
+        *key = k;
+        return n;
+    }
+    jc_pool_free(js->pool, k, sizeof(jc_key_t) + k->size + k->free);
+    *key = ik;
+    return n;
+}
+
+/* with JC_JSON_LAZY, the object or array at p is only skipped */
+static ssize_t __jc_json_skip(const char *p, const char *end,
+        jc_val_t *val)
+{
+    const char  *q;
+
+    if ((q = jc_scan_skip(p, end)) == NULL) {
+        return -1;
+    }
+    val->type = *p == '{' ? JC_JSON : JC_ARRAY;
+    val->len = JC_VAL_LAZY;
+    jc_val_span(val, p, q - p);
+    return q - p;
+}
+
+static ssize_t __jc_json_parse_val(jc_json_t *js, const char *p,
+        const char *end, jc_val_t *val)
+{
+    if ((js->flags & JC_JSON_LAZY) && (*p == '{' || *p == '[')) {
+        return __jc_json_skip(p, end, val);
+    }
+
+    switch (*p) {
+        case '\"':
+            return __jc_json_parse_str(js, p, end, val);
+        case '[':
+            return __jc_json_parse_array(js, p, end, val, NULL);
+        case '{':
+            return __jc_json_parse_sub_json(js, p, end, val, NULL, NULL);
+        case 't':
+        case 'f':
+            return __jc_json_parse_bool(p, end, val);
+        case 'n':
+            return __jc_json_parse_null(p, end, val);
+        default:
+            if ((*p >= '0' && *p <= '9') || (*p == '-')) {
+                return __jc_json_parse_number(p, end, val);
+            }
+    }
+    return -1;
+}
+
+jc_val_t *jc_json_find(jc_json_t *js, const char *key)
+{
+    int        idx;
+    size_t     len;
+    jc_key_t  *ik;
+
+    len = strlen(key);
+    ik = NULL;
+    if (js->dict != NULL) {
+        ik = jc_intern_find(js->dict, key, len, jc_hash(key, len));
+    }
+
+    idx = jc_kv_find(js->shape, key, len, ik);
+    if (idx == -1 || jc_val_load(js->root, &js->val[idx]) != 0) {
+        return NULL;
+    }
+    return &js->val[idx];
+}
+
+jc_val_t *jc_json_value(jc_json_t *js)
+{
+    jc_val_t  v;
+
+    if (js->top == NULL) {
+        v.type = JC_JSON;
+        v.len = 0;
+        v.data.j = js;
+        if (jc_json_set_top(js, &v) != 0) {
+            return NULL;
+        }
+    }
+    if (jc_val_load(js, js->top) != 0) {
+        return NULL;
+    }
+    return js->top;
+}
+
+jc_json_t *jc_json_parse(const char *p)
+{
+    assert(p != NULL);
+
+    return jc_json_parse_n(p, strlen(p), NULL);
+}
+
+/* make val the value of js at the top */
+static int jc_json_set_top(jc_json_t *js, jc_val_t *val)
+{
+    if (js->top == NULL) {
+        if ((js->top = jc_pool_alloc(js->pool, sizeof(jc_val_t))) == NULL) {
+            return -1;
+        }
+    }
+    *js->top = *val;
+    return 0;
+}
+
+/*
+ * parse the value at buf into the empty js, only path if not NULL;
+ * an object is parsed into js itself, any other value is its top
+ * */
+static int jc_json_parse_in(jc_json_t *js, const char *buf, size_t len,
+        size_t *used, jc_path_t *path)
+{
+    ssize_t       n;
+    jc_val_t      val;
+    const char   *p, *end;
+
+    end = buf + len;
+    p = jc_skip_ws(buf, end);
+    if (p == end) {
+        return -1;
+    }
+
+    if (*p == '{') {
+        n = __jc_json_parse_obj(js, p, end, NULL, path);
+    } else if (!jc_path_fits(path, *p)) {
+        /* not named by path, js stays empty */
+        n = __jc_json_skip_val(js, p, end);
+    } else {
+        n = __jc_json_parse_sel(js, p, end, &val, path);
+        if (n != -1 && jc_json_set_top(js, &val) != 0) {
+            return -1;
+        }
+    }
+    if (n == -1) {
+        return -1;
+    }
+
+    /* eat the trailing whitespace, so that the next message starts at used */
+    p = jc_skip_ws(p + n, end);
+    if (used == NULL) {
+        /* no one to tell where the value ends, nothing may follow it */
+        return p == end ? 0 : -1;
+    }
+    *used = (size_t)(p - buf);
+    return 0;
+}
+
+int jc_json_parse_to(jc_json_t *js, const char *buf, size_t len,
+        size_t *used)
+{
+    assert(js != NULL);
+    assert(buf != NULL);
 
-            case JC_ARR_END:
-                *val = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-                if (*val == NULL) {
-                    return -1;
-                }
-                (*val)->type = JC_ARRAY;
-                (*val)->data.a = arr;
-                return n + 1;
-        }
+    if (js->root != js || js->shape->size != 0 || js->top != NULL) {
+        return -1;
     }
-    return -1;
+    return jc_json_parse_in(js, buf, len, used, NULL);
 }
 
-typedef enum {
-    JC_OBJ_START = 0,
-    JC_OBJ_LBRACE,
-    JC_OBJ_KEY,
-    JC_OBJ_VAL,
-    JC_OBJ_COLON,
-} jc_obj_state_t;
+jc_json_t *jc_json_parse_n(const char *buf, size_t len, size_t *used)
+{
+    return jc_json_parse_ex(buf, len, used, 0);
+}
 
-static int __jc_json_parse_sub_json(jc_json_t *js, const char *p, jc_val_t **js_val)
+jc_json_t *jc_json_parse_ex(const char *buf, size_t len, size_t *used,
+        int flags)
 {
-    int              n, inc;
-    jc_key_t        *key;
-    jc_val_t        *val;
-    jc_json_t       *sub_js;
-    jc_obj_state_t   state;
+    jc_json_t    *js;
 
-    if ((sub_js = jc_json_create()) == NULL) {
-        return -1;
+    assert(buf != NULL);
+
+    if ((js = jc_json_create_ex(flags)) == NULL) {
+        return NULL;
+    }
+    if (jc_json_parse_in(js, buf, len, used, NULL) != 0) {
+        jc_json_destroy(js);
+        return NULL;
     }
+    return js;
+}
 
-    if (p[0] == '{') {
-        state = JC_OBJ_START;
-    } else {
-        goto error;
+jc_json_t *jc_json_parse_path(const char *buf, size_t len, size_t *used,
+        jc_path_t *path)
+{
+    jc_json_t    *js;
+
+    assert(buf != NULL);
+    assert(path != NULL);
+
+    if ((js = jc_json_create()) == NULL) {
+        return NULL;
     }
+    if (jc_json_parse_in(js, buf, len, used, jc_path_sel(path)) != 0) {
+        jc_json_destroy(js);
+        return NULL;
+    }
+    return js;
+}
 
-    for (n = 0; p[n] != '\0'; ++n) {
-        switch (state) {
-            case JC_OBJ_START:
-                if (p[n] == '{') {
-                    state = JC_OBJ_LBRACE;
-                    break;
-                }
-                goto error;
+jc_json_t *jc_json_parse_into(jc_pool_t *pool, const char *buf, size_t len,
+        size_t *used)
+{
+    return jc_json_parse_into_ex(pool, buf, len, used, 0);
+}
 
-            case JC_OBJ_LBRACE:
-                if (p[n] == '}') {
-                    /* empty json */
-                    *js_val = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-                    if (*js_val == NULL) {
-                        goto error;
-                    }
-                    (*js_val)->type = JC_JSON;
-                    (*js_val)->data.j = sub_js;
-                    return n + 1;
-                } else if (p[n] == '\"') {
-                    --n;    /* back n because n will incr 1 in for loop */
-                    state = JC_OBJ_KEY;
-                } else {
-                    goto error;
-                }
-                break;
+jc_json_t *jc_json_parse_into_ex(jc_pool_t *pool, const char *buf,
+        size_t len, size_t *used, int flags)
+{
+    jc_json_t    *js;
 
-            case JC_OBJ_KEY:
-                inc = __jc_json_parse_key(sub_js, &p[n], &key);
-                if (inc > 0) {
-                    n += inc - 1;
-                    state = JC_OBJ_COLON;
-                    break;
-                }
-                goto error;
+    assert(pool != NULL);
+    assert(buf != NULL);
 
-            case JC_OBJ_COLON:
-                if (p[n] == ':') {
-                    state = JC_OBJ_VAL;
-                    break;
-                }
-                goto error;
+    if ((js = jc_json_create_in(pool)) == NULL) {
+        return NULL;
+    }
+    js->flags = flags;
+    if (jc_json_parse_in(js, buf, len, used, NULL) != 0) {
+        return NULL;
+    }
+    return js;
+}
 
-            case JC_OBJ_VAL:
-                inc = __jc_json_parse_val(sub_js, &p[n], &val);
-                if (inc == -1) {
-                    goto error;
-                }
-                n += inc;
-                if (p[n] == ',') {
-                    /* in JC_OBJ_COMMA state */
-                    state = JC_OBJ_KEY;
-                    if (jc_json_add_kv(sub_js, key, val) == -1) {
-                        goto error;
-                    }
-                } else if (p[n] == '}') {
-                    /* Accept */
-                    if (jc_json_add_kv(sub_js, key, val) == -1) {
-                        goto error;
-                    }
-                    *js_val = jc_pool_alloc(js->pool, sizeof(jc_val_t));
-                    if (*js_val == NULL) {
-                        goto error;
-                    }
-                    (*js_val)->type = JC_JSON;
-                    (*js_val)->data.j = sub_js;
-                    return n + 1;
-                } else {
-                    goto error;
-                }
+/* [p, p + len) is a value cut short, which more bytes may complete */
+static int jc_json_is_cut(const char *p, size_t len)
+{
+    int              cut;
+    jc_sax_t         none;
+    jc_sax_parser_t  sp;
+
+    memset(&none, 0, sizeof(none));
+    jc_sax_init(&sp, &none, NULL);
+    cut = jc_sax_feed(&sp, p, len) == 0 && !sp.done;
+    jc_sax_free(&sp);
+    return cut;
+}
+
+/*
+ * Every record goes into pool, which is reset once it is handled, so
+ * the blocks of the first records serve all the others.
+ * */
+ssize_t jc_json_parse_lines(jc_pool_t *pool, const char *buf, size_t len,
+        int flags, size_t *used, jc_json_each_t each, void *ctx)
+{
+    int          rc;
+    size_t       n;
+    ssize_t      count;
+    jc_json_t   *js;
+    const char  *p, *end;
+
+    assert(pool != NULL);
+    assert(buf != NULL);
+    assert(each != NULL);
+
+    end = buf + len;
+    count = 0;
+
+    for (p = jc_skip_ws(buf, end); p != end; p += n) {
+        if ((js = jc_json_alloc(pool, NULL)) == NULL) {
+            goto failed;
+        }
+        js->flags = flags;
+        if (jc_json_parse_in(js, p, end - p, &n, NULL) != 0) {
+            if (jc_json_is_cut(p, end - p)) {
+                /* pending, the rest of it is yet to come */
+                break;
+            }
+            goto failed;
+        }
+        /* records are apart, "1 2" is two of them but "12" is one, and
+         * the last one may go on in the next bytes */
+        if (!jc_is_ws(p[n - 1])) {
+            if (p + n == end) {
                 break;
+            }
+            goto failed;
+        }
 
-            default:
-                /* some error happens */
-                assert(0);
+        rc = each(ctx, js);
+        jc_pool_reset(pool);
+        if (rc != 0) {
+            p += n;
+            goto failed;
         }
+        ++count;
+    }
+
+    jc_pool_reset(pool);
+    if (used != NULL) {
+        *used = (size_t)(p - buf);
     }
+    return count;
 
-error:
-    jc_json_destroy(sub_js);
+failed:
+    jc_pool_reset(pool);
+    if (used != NULL) {
+        *used = (size_t)(p - buf);
+    }
     return -1;
 }
 
-typedef enum {
-    JC_STR_START = 0,
-    JC_STR_START_QUA,
-    JC_STR_CHR,
-    JC_STR_TRANS,        /* reverse solidus */
-    JC_STR_END_QUA,
-} jc_str_state_t;
+int jc_json_reserve(jc_json_t *js, size_t n)
+{
+    return jc_kv_grow(js, n);
+}
 
-static int __jc_json_parse_key(jc_json_t *js, const char *p, jc_key_t **key)
+int jc_array_reserve(jc_array_t *jarray, size_t n)
 {
-    int      tmp;
-    size_t   n, size;
+    return jc_array_grow(jarray, n);
+}
 
-    jc_str_state_t  state;
+size_t jc_json_size(jc_json_t *js)
+{
+    return js->shape->size;
+}
 
-    if (p[0] != '\"') {
-        return -1;
-    }
-    for (n = 1, size = 0; /* void */ ; /* void */ ) {
-        switch (p[n]) {
-            case '\0':
-                return -1;
-            case '\\':
-                if (p[n+1] == '\0') {
-                    return -1;
-                }
-                /* calc size of Unicode '\uXXXX' */
-                if (p[n+1] == 'u') {
-                    tmp = jc_wctomb(&p[n], NULL);
-                    if (tmp == -1) {
-                        return -1;
-                    }
-                    n += 5;
-                    size += tmp;
-                } else {
-                    n += 2;
-                    ++size;
-                }
-                break;
-            case '"':
-                goto parse;
-            default:
-                ++n;
-                ++size;
-        }
+jc_str_t *jc_json_get_key(jc_json_t *js, size_t idx)
+{
+    if (jc_json_sort(js) != 0) {
+        return NULL;
     }
+    return idx >= js->shape->size ? NULL : js->shape->key[idx];
+}
 
-parse:
-    size = jc_align(sizeof(jc_key_t) + size + 1);  /* add the terminating zero */
-    if ((*key = jc_pool_alloc(js->pool, size)) == NULL) {
-        return -1;
+jc_val_t *jc_json_get_val(jc_json_t *js, size_t idx)
+{
+    if (jc_json_sort(js) != 0 || idx >= js->shape->size
+            || jc_val_load(js->root, &js->val[idx]) != 0)
+    {
+        return NULL;
     }
-    (*key)->size = 0;
-    (*key)->free = size - sizeof(jc_key_t);
+    return &js->val[idx];
+}
 
-    for (n = 0, state = JC_STR_START, size = 0; p[n] != '\0'; /* void */ ) {
-        switch (state) {
-            case JC_STR_START:
-                if (p[n++] != '\"') {
-                    return -1;
-                }
-                state = JC_STR_START_QUA;
-                break;
+/* ====================================
+ * Incremental parse: the events of a
+ * jc_sax_parser_t are built into the
+ * same jc_json_t jc_json_parse() makes.
+ * ==================================== */
 
-            case JC_STR_START_QUA:
-                if (p[n] == '\"') {
-                    state = JC_STR_END_QUA;
-                } else if (p[n] == '\\') {
-                    state = JC_STR_TRANS;
-                } else {
-                    state = JC_STR_CHR;
-                    (*key)->body[size++] = p[n];
-                }
-                ++n;
-                break;
+typedef struct {
+    jc_json_t   *js;       /* object, or the owner of the array */
+    jc_array_t  *arr;      /* NULL in an object */
+    jc_key_t    *key;      /* key of the next value in an object */
+} jc_frame_t;
+
+struct jc_parser_s {
+    jc_sax_parser_t   sax;
+    jc_json_t        *root;
+    jc_frame_t       *stack;
+    size_t            depth;
+    size_t            cap;
+};
 
-            case JC_STR_CHR:
-                if (p[n] == '\"') {
-                    state = JC_STR_END_QUA;
-                } else if (p[n] == '\\') {
-                    state = JC_STR_TRANS;
-                } else {
-                    (*key)->body[size++] = p[n];
-                }
-                ++n;
-                break;
+/* the document, made at the first value */
+static jc_json_t *jc_parser_doc(jc_parser_t *pr)
+{
+    if (pr->root == NULL) {
+        pr->root = jc_json_create();
+    }
+    return pr->root;
+}
 
-            case JC_STR_TRANS:
-                switch (p[n]) {
-                    case '\"':
-                        (*key)->body[size++] = '\"';
-                        break;
-                    case '\\':
-                        (*key)->body[size++] = '\\';
-                        break;
-                    case '/':
-                        (*key)->body[size++] = '/';
-                        break;
-                    case 'b':
-                        (*key)->body[size++] = '\b';
-                        break;
-                    case 'f':
-                        (*key)->body[size++] = '\f';
-                        break;
-                    case 'n':
-                        (*key)->body[size++] = '\n';
-                        break;
-                    case 'r':
-                        (*key)->body[size++] = '\r';
-                        break;
-                    case 't':
-                        (*key)->body[size++] = '\t';
-                        break;
-                    case 'u':
-                        /* use wctomb to trans Unicode to Chars */
-                        size += jc_wctomb(&p[n-1], &((*key)->body[size]));
-                        n += 4;
-                        break;
-                    default:
-                        /* illegal char: \x */
-                        return -1;
-                }
-                ++n;
-                state = JC_STR_CHR;
-                break;
+static int jc_parser_add(jc_parser_t *pr, jc_val_t *val)
+{
+    jc_frame_t  *f;
 
-            case JC_STR_END_QUA:
-                (*key)->body[size++] = '\0';
-                assert(size <= (*key)->free);
-                (*key)->free -= size;
-                (*key)->size = size;
-                return n;
+    if (pr->depth == 0) {
+        /* an array or a scalar at the top */
+        if (jc_parser_doc(pr) == NULL) {
+            return -1;
         }
+        return jc_json_set_top(pr->root, val);
     }
-    return -1;
+    f = &pr->stack[pr->depth - 1];
+    if (f->arr != NULL) {
+        return jc_array_append(f->arr, val);
+    }
+    return jc_json_add_kv(f->js, f->key, val);
 }
 
-static int __jc_json_parse_val(jc_json_t *js, const char *p, jc_val_t **val)
+static int jc_parser_push(jc_parser_t *pr, jc_json_t *js, jc_array_t *arr)
 {
-    switch (*p) {
-        case '\"':
-            return __jc_json_parse_str(js, p, val);
-        case '[':
-            return __jc_json_parse_array(js, p, val);
-        case '{':
-            return __jc_json_parse_sub_json(js, p, val);
-        case 't':
-        case 'f':
-            return __jc_json_parse_bool(js, p, val);
-        case 'n':
-            return __jc_json_parse_null(js, p, val);
-        default:
-            if ((*p >= '0' && *p <= '9') || (*p == '-')) {
-                return __jc_json_parse_number(js, p, val);
-            }
+    size_t       cap;
+    jc_frame_t  *f;
+
+    if (pr->depth == pr->cap) {
+        cap = pr->cap ? pr->cap * 2 : 16;
+        if ((f = realloc(pr->stack, cap * sizeof(jc_frame_t))) == NULL) {
+            return -1;
+        }
+        pr->stack = f;
+        pr->cap = cap;
     }
-    *val = NULL;
-    return -1;
+    f = &pr->stack[pr->depth++];
+    f->js = js;
+    f->arr = arr;
+    f->key = NULL;
+    return 0;
 }
 
-jc_val_t *jc_json_find(jc_json_t *js, const char *key)
+static int jc_parser_start_object(void *ctx)
 {
-    int  idx;
+    jc_parser_t  *pr = ctx;
+    jc_json_t    *js;
+    jc_val_t      v;
 
-    idx = jc_bsearch_str_key(js, key);
-    if (idx == -1) {
-        return NULL;
+    if (pr->depth == 0) {
+        if ((js = jc_parser_doc(pr)) == NULL) {
+            return -1;
+        }
+    } else {
+        /* nested in the pool of the document */
+        if ((js = jc_json_alloc(pr->root->pool, pr->root)) == NULL) {
+            return -1;
+        }
+        v.type = JC_JSON;
+        v.len = 0;
+        v.data.j = js;
+        if (jc_parser_add(pr, &v) != 0) {
+            return -1;
+        }
     }
-    return js->vals[idx];
+    return jc_parser_push(pr, js, NULL);
 }
 
-jc_json_t *jc_json_parse(const char *p)
+static int jc_parser_start_array(void *ctx)
 {
-    int             n;
-    jc_key_t       *key;
-    jc_val_t       *val;
-    jc_json_t      *js;
-    jc_obj_state_t  state;
-
-    assert(p != NULL);
+    jc_parser_t  *pr = ctx;
+    jc_json_t    *js;
+    jc_val_t      v;
 
-    if ((js = jc_json_create()) == NULL) {
-        return NULL;
+    js = pr->depth == 0 ? jc_parser_doc(pr) : pr->stack[pr->depth - 1].js;
+    if (js == NULL) {
+        return -1;
+    }
+    v.type = JC_ARRAY;
+    v.len = 0;
+    if ((v.data.a = jc_array_create(js)) == NULL
+            || jc_parser_add(pr, &v) != 0)
+    {
+        return -1;
     }
+    return jc_parser_push(pr, js, v.data.a);
+}
 
-    state = JC_OBJ_START;
-    while (*p != '\0') {
-        switch (state) {
-            case JC_OBJ_START:
-                if (*p++ == '{') {
-                    state = JC_OBJ_LBRACE;
-                    break;
-                }
-                goto error;
+static int jc_parser_end_object(void *ctx)
+{
+    jc_parser_t  *pr = ctx;
 
-            case JC_OBJ_LBRACE:
-                if (*p == '}') {
-                    return js;
-                } else if (*p == '\"') {
-                    state = JC_OBJ_KEY;
-                } else {
-                    goto error;
-                }
-                break;
+    return jc_json_seal(pr->stack[--pr->depth].js, NULL);
+}
 
-            case JC_OBJ_KEY:
-                n = __jc_json_parse_key(js, p, &key);
-                if (n > 0) {
-                    p += n;
-                    state = JC_OBJ_COLON;
-                    break;
-                }
-                goto error;
+static int jc_parser_end_array(void *ctx)
+{
+    jc_parser_t  *pr = ctx;
 
-            case JC_OBJ_COLON:
-                if (*p++ == ':') {
-                    state = JC_OBJ_VAL;
-                    break;
-                }
-                goto error;
+    --pr->depth;
+    return 0;
+}
 
-            case JC_OBJ_VAL:
-                if ((n = __jc_json_parse_val(js, p, &val)) == -1) {
-                    goto error;
-                }
-                p += n;
-                if (*p == ',') {
-                    /* in JC_OBJ_COMMA state */
-                    state = JC_OBJ_KEY;
-                    ++p;
-                    jc_json_add_kv(js, key, val);
-                } else if (*p == '}') {
-                    /* Accept */
-                    jc_json_add_kv(js, key, val);
-                    return js;
-                } else {
-                    goto error;
-                }
-                break;
+static int jc_parser_key(void *ctx, const char *key, size_t len)
+{
+    jc_parser_t  *pr = ctx;
+    jc_frame_t   *f;
 
-            default:
-                /* some error happens */
-                assert(0);
-        }
+    f = &pr->stack[pr->depth - 1];
+    f->key = jc_json_key(f->js, key, len);
+    return f->key == NULL ? -1 : 0;
+}
+
+static int jc_parser_string(void *ctx, const char *s, size_t len)
+{
+    jc_parser_t  *pr = ctx;
+    jc_json_t    *js;
+    jc_val_t      v;
+
+    if ((js = jc_parser_doc(pr)) == NULL
+            || jc_val_set_str(&v, js->pool, s, len) != 0)
+    {
+        return -1;
     }
+    return jc_parser_add(pr, &v);
+}
 
-error:
-    jc_json_destroy(js);
-    return NULL;
+static int jc_parser_number(void *ctx, double n)
+{
+    jc_val_t  v;
+
+    v.type = JC_NUM;
+    v.data.n = n;
+    return jc_parser_add(ctx, &v);
 }
 
-size_t jc_json_size(jc_json_t *js)
+static int jc_parser_integer(void *ctx, int64_t i)
 {
-    return js->size;
+    jc_val_t  v;
+
+    v.type = JC_INT;
+    v.data.i = i;
+    return jc_parser_add(ctx, &v);
 }
 
-jc_str_t *jc_json_get_key(jc_json_t *js, size_t idx)
+static int jc_parser_boolean(void *ctx, int b)
+{
+    jc_val_t  v;
+
+    v.type = JC_BOOL;
+    v.data.b = (jc_bool_t)(b != 0);
+    return jc_parser_add(ctx, &v);
+}
+
+static int jc_parser_null(void *ctx)
 {
-    return idx >= js->size ? NULL : js->keys[idx];
+    jc_val_t  v;
+
+    v.type = JC_NULL;
+    return jc_parser_add(ctx, &v);
 }
 
-jc_val_t *jc_json_get_val(jc_json_t *js, size_t idx)
+static const jc_sax_t jc_parser_sax = {
+    jc_parser_start_object,
+    jc_parser_end_object,
+    jc_parser_start_array,
+    jc_parser_end_array,
+    jc_parser_key,
+    jc_parser_string,
+    jc_parser_number,
+    jc_parser_integer,
+    jc_parser_boolean,
+    jc_parser_null
+};
+
+jc_parser_t *jc_parser_create()
+{
+    jc_parser_t  *pr;
+
+    if ((pr = malloc(sizeof(jc_parser_t))) == NULL) {
+        return NULL;
+    }
+    jc_sax_init(&pr->sax, &jc_parser_sax, pr);
+    pr->root = NULL;
+    pr->stack = NULL;
+    pr->depth = 0;
+    pr->cap = 0;
+    return pr;
+}
+
+int jc_parser_feed(jc_parser_t *pr, const char *buf, size_t len)
+{
+    return jc_sax_feed(&pr->sax, buf, len);
+}
+
+jc_json_t *jc_parser_finish(jc_parser_t *pr)
 {
-    return idx >= js->size ? NULL : js->vals[idx];
+    jc_json_t  *js;
+
+    if (jc_sax_finish(&pr->sax) != 0) {
+        return NULL;
+    }
+    js = pr->root;
+    pr->root = NULL;
+    return js;
+}
+
+void jc_parser_destroy(jc_parser_t *pr)
+{
+    if (pr == NULL) {
+        return;
+    }
+    jc_json_destroy(pr->root);
+    jc_sax_free(&pr->sax);
+    free(pr->stack);
+    free(pr);
 }
@@ -1,67 +1,147 @@
 #include "jc_wchar.h"
 
-#include <string.h>
+/*
+ * Everything here is read-only, so it is safe to use from any number
+ * of threads and does not depend on the locale of the process.
+ * */
 
-static int hex_table[256];
-static int jc_wc_init(const char *unicode, char *chs);
-static int jc_wctomb_internal(const char *unicode, char *chs);
+static const signed char jc_hex_table[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
 
-static int (*jc_wctomb_func)(const char *, char *) = jc_wc_init;
+/* bytes of the UTF-8 form of a code point, indexed by its bit length */
+static const unsigned char jc_utf8_len[22] = {
+    1, 1, 1, 1, 1, 1, 1, 1,     /*  0 -  7 bits */
+    2, 2, 2, 2,                 /*  8 - 11 bits */
+    3, 3, 3, 3, 3,              /* 12 - 16 bits */
+    4, 4, 4, 4, 4               /* 17 - 21 bits */
+};
 
-static int ch2hex(char ch)
+/* leading byte marks of a UTF-8 sequence, indexed by its length */
+static const unsigned char jc_utf8_mark[5] = {
+    0x00, 0x00, 0xC0, 0xE0, 0xF0
+};
+
+static int jc_hex4(const char *p)
 {
-    return hex_table[(unsigned char)ch];
+    int  h0, h1, h2, h3;
+
+    h0 = jc_hex_table[(unsigned char)p[0]];
+    h1 = jc_hex_table[(unsigned char)p[1]];
+    h2 = jc_hex_table[(unsigned char)p[2]];
+    h3 = jc_hex_table[(unsigned char)p[3]];
+    if ((h0 | h1 | h2 | h3) < 0) {
+        return -1;
+    }
+    return h0 << 12 | h1 << 8 | h2 << 4 | h3;
 }
 
-static int jc_wc_init(const char *unicode, char *chs)
+int jc_utf8_encode(uint32_t cp, char *out)
 {
-    char  ch;
+    int  bits, len, i;
 
-    setlocale(LC_ALL, "");
-    memset(hex_table, -1, sizeof hex_table);
-    for (ch = '0'; ch <= '9'; ++ch) {
-        hex_table[ch] = ch - '0';
+    if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        return -1;
     }
-    for (ch = 'a'; ch <= 'f'; ++ch) {
-        hex_table[ch] = ch - 'a' + 10;
+
+    bits = cp == 0 ? 0 : 32 - __builtin_clz(cp);
+    len = jc_utf8_len[bits];
+    if (len == 1) {
+        out[0] = (char)cp;
+        return 1;
     }
-    for (ch = 'A'; ch <= 'F'; ++ch) {
-        hex_table[ch] = ch - 'A' + 10;
+    for (i = len - 1; i != 0; --i) {
+        out[i] = (char)(0x80 | (cp & 0x3F));
+        cp >>= 6;
     }
-
-    jc_wctomb_func = jc_wctomb_internal;
-
-    return jc_wctomb_internal(unicode, chs);
+    out[0] = (char)(jc_utf8_mark[len] | cp);
+    return len;
 }
 
-static int jc_wctomb_internal(const char *unicode, char *chs)
+static int jc_unescape_unicode(const char *p, const char *end, char *out,
+        size_t *used)
 {
-    int      i, num;
-    char    *p;
-    char     buf[16];
-    wchar_t  wc;
+    int  hi, lo;
+
+    if (end - p < 6 || (hi = jc_hex4(&p[2])) == -1) {
+        return -1;
+    }
+    *used = 6;
 
-    p = (char *)unicode;
-    if (p[0] != '\\' || p[1] != 'u') {
+    if (hi >= 0xDC00 && hi <= 0xDFFF) {
+        /* lone low surrogate */
         return -1;
     }
-    for (p = (char *)&unicode[2], i = 0, wc = 0; i != 4; ++i) {
-        num = ch2hex(p[i]);
-        if (num == -1) {
+
+    if (hi >= 0xD800 && hi <= 0xDBFF) {
+        /* high surrogate, must be followed by '\uDC00' - '\uDFFF' */
+        if (end - p < 12 || p[6] != '\\' || p[7] != 'u') {
             return -1;
         }
-        wc <<= 4; /* wc *= 16 */
-        wc += 0xF & (wchar_t)num;
-    }
-    if (chs != NULL) {
-        p = chs;
-    } else {
-        p = buf;
+        lo = jc_hex4(&p[8]);
+        if (lo < 0xDC00 || lo > 0xDFFF) {
+            return -1;
+        }
+        *used = 12;
+        return jc_utf8_encode(0x10000 + ((hi - 0xD800) << 10) + (lo - 0xDC00),
+                out);
     }
-    return wctomb(p, wc);
+
+    return jc_utf8_encode(hi, out);
 }
 
-int jc_wctomb(const char *unicode, char *chs)
+int jc_unescape(const char *p, const char *end, char *out, size_t *used)
 {
-    return jc_wctomb_func(unicode, chs);
+    if (end - p < 2 || p[0] != '\\') {
+        return -1;
+    }
+
+    *used = 2;
+
+    switch (p[1]) {
+        case '\"':
+            *out = '\"';
+            return 1;
+        case '\\':
+            *out = '\\';
+            return 1;
+        case '/':
+            *out = '/';
+            return 1;
+        case 'b':
+            *out = '\b';
+            return 1;
+        case 'f':
+            *out = '\f';
+            return 1;
+        case 'n':
+            *out = '\n';
+            return 1;
+        case 'r':
+            *out = '\r';
+            return 1;
+        case 't':
+            *out = '\t';
+            return 1;
+        case 'u':
+            return jc_unescape_unicode(p, end, out, used);
+        default:
+            /* illegal char: \x */
+            return -1;
+    }
 }
@@ -0,0 +1,177 @@
+#include "jc_writer.h"
+
+#include <stddef.h>
+#include <assert.h>
+
+/* bits of jc_writer_t.stack */
+#define JC_W_OBJECT 0x01    /* object, or else array */
+#define JC_W_MORE   0x02    /* has members, next one needs a ',' */
+#define JC_W_KEY    0x04    /* key written, waiting for its value */
+
+void jc_writer_init(jc_writer_t *w, jc_buf_t *out)
+{
+    assert(out != NULL);
+
+    w->out = out;
+    w->count = 0;
+    w->depth = 0;
+}
+
+/*
+ * put what goes before a value, if one may come; the state is only
+ * changed by jc_writer_done() once the value itself is out, so that a
+ * failed write leaves it as it was
+ * */
+static int jc_writer_value(jc_writer_t *w)
+{
+    unsigned char  st;
+
+    if (w->depth == 0) {
+        return w->count == 0 ? 0 : jc_buf_putc(w->out, '\n');
+    }
+
+    st = w->stack[w->depth - 1];
+    if (st & JC_W_OBJECT) {
+        /* a value without key */
+        return st & JC_W_KEY ? 0 : -1;
+    }
+    return st & JC_W_MORE ? jc_buf_putc(w->out, ',') : 0;
+}
+
+/* a value was put */
+static void jc_writer_done(jc_writer_t *w)
+{
+    unsigned char  *st;
+
+    if (w->depth == 0) {
+        ++w->count;
+        return;
+    }
+
+    st = &w->stack[w->depth - 1];
+    if (*st & JC_W_OBJECT) {
+        *st &= ~JC_W_KEY;
+    } else {
+        *st |= JC_W_MORE;
+    }
+}
+
+static int jc_writer_begin(jc_writer_t *w, unsigned char type, char ch)
+{
+    if (w->depth == JC_WRITER_MAXDEPTH || jc_writer_value(w) != 0
+            || jc_buf_putc(w->out, ch) != 0)
+    {
+        return -1;
+    }
+    jc_writer_done(w);
+    w->stack[w->depth++] = type;
+    return 0;
+}
+
+static int jc_writer_end(jc_writer_t *w, unsigned char type, char ch)
+{
+    unsigned char  st;
+
+    if (w->depth == 0) {
+        return -1;
+    }
+    st = w->stack[w->depth - 1];
+    if ((st & JC_W_OBJECT) != type || (st & JC_W_KEY)) {
+        return -1;
+    }
+    if (jc_buf_putc(w->out, ch) != 0) {
+        return -1;
+    }
+    --w->depth;
+    return 0;
+}
+
+int jc_writer_begin_object(jc_writer_t *w)
+{
+    return jc_writer_begin(w, JC_W_OBJECT, '{');
+}
+
+int jc_writer_end_object(jc_writer_t *w)
+{
+    return jc_writer_end(w, JC_W_OBJECT, '}');
+}
+
+int jc_writer_begin_array(jc_writer_t *w)
+{
+    return jc_writer_begin(w, 0, '[');
+}
+
+int jc_writer_end_array(jc_writer_t *w)
+{
+    return jc_writer_end(w, 0, ']');
+}
+
+int jc_writer_key(jc_writer_t *w, const char *key, size_t len)
+{
+    unsigned char  *st;
+
+    if (w->depth == 0) {
+        return -1;
+    }
+    st = &w->stack[w->depth - 1];
+    if (!(*st & JC_W_OBJECT) || (*st & JC_W_KEY)) {
+        return -1;
+    }
+
+    if (((*st & JC_W_MORE) && jc_buf_putc(w->out, ',') != 0)
+            || jc_buf_put_str(w->out, key, len) != 0
+            || jc_buf_putc(w->out, ':') != 0)
+    {
+        return -1;
+    }
+    *st |= JC_W_MORE | JC_W_KEY;
+    return 0;
+}
+
+int jc_writer_str(jc_writer_t *w, const char *s, size_t len)
+{
+    if (jc_writer_value(w) != 0 || jc_buf_put_str(w->out, s, len) != 0) {
+        return -1;
+    }
+    jc_writer_done(w);
+    return 0;
+}
+
+int jc_writer_num(jc_writer_t *w, double n)
+{
+    if (jc_writer_value(w) != 0 || jc_buf_put_num(w->out, n) != 0) {
+        return -1;
+    }
+    jc_writer_done(w);
+    return 0;
+}
+
+int jc_writer_int(jc_writer_t *w, int64_t i)
+{
+    if (jc_writer_value(w) != 0 || jc_buf_put_int(w->out, i) != 0) {
+        return -1;
+    }
+    jc_writer_done(w);
+    return 0;
+}
+
+int jc_writer_bool(jc_writer_t *w, int b)
+{
+    if (jc_writer_value(w) != 0
+            || (b ? jc_buf_put(w->out, "true", 4)
+                  : jc_buf_put(w->out, "false", 5)) != 0)
+    {
+        return -1;
+    }
+    jc_writer_done(w);
+    return 0;
+}
+
+int jc_writer_null(jc_writer_t *w)
+{
+    if (jc_writer_value(w) != 0 || jc_buf_put(w->out, "null", 4) != 0) {
+        return -1;
+    }
+    jc_writer_done(w);
+    return 0;
+}
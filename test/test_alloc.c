@@ -0,0 +1,251 @@
+#include "jc_alloc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+static int filled(const char *m, int ch, size_t len)
+{
+    size_t  i;
+
+    for (i = 0; i != len; ++i) {
+        if (m[i] != ch) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* the last chunk of a block grows and shrinks in place */
+static void test_in_place(void)
+{
+    char       *m, *n;
+    jc_pool_t  *pool;
+
+    pool = jc_pool_create(4096);
+    check(pool != NULL);
+
+    m = jc_pool_alloc(pool, 16);
+    check(m != NULL);
+    memset(m, 'a', 16);
+
+    n = jc_pool_realloc(pool, m, 16, 256);
+    check(n == m);
+    check(filled(n, 'a', 16));
+
+    n = jc_pool_realloc(pool, m, 256, 32);
+    check(n == m);
+
+    /* not the last one any more: a copy */
+    check(jc_pool_alloc(pool, 8) != NULL);
+    n = jc_pool_realloc(pool, m, 32, 64);
+    check(n != NULL && n != m);
+    check(filled(n, 'a', 16));
+
+    jc_pool_destroy(pool);
+}
+
+/*
+ * The blocks after the first have more room than max; a chunk at the
+ * tail of one must not grow in place past max, or it is taken for a
+ * large chunk by the next realloc.
+ * */
+static void test_grow_past_max(void)
+{
+    char       *m, *prev;
+    jc_pool_t  *pool;
+
+    pool = jc_pool_create(1024);
+    check(pool != NULL);
+
+    /* fill the first block, m is the first chunk of the next one */
+    prev = jc_pool_alloc(pool, 8);
+    while ((m = jc_pool_alloc(pool, 8)) == prev + 8) {
+        prev = m;
+    }
+    check(m != NULL);
+    memset(m, 'a', 8);
+
+    m = jc_pool_realloc(pool, m, 8, 976);
+    check(m != NULL);
+    check(filled(m, 'a', 8));
+    memset(m, 'b', 976);
+
+    m = jc_pool_realloc(pool, m, 976, 2000);
+    check(m != NULL);
+    check(filled(m, 'b', 976));
+    memset(m, 'c', 2000);
+
+    m = jc_pool_realloc(pool, m, 2000, 8000);
+    check(m != NULL);
+    check(filled(m, 'c', 2000));
+
+    jc_pool_destroy(pool);
+}
+
+/* a large chunk shrunk to max or less is a small chunk from then on */
+static void test_shrink_below_max(void)
+{
+    char       *m;
+    jc_pool_t  *pool;
+
+    pool = jc_pool_create(1024);
+    check(pool != NULL);
+
+    m = jc_pool_alloc(pool, 4000);
+    check(m != NULL);
+    memset(m, 'c', 4000);
+
+    m = jc_pool_realloc(pool, m, 4000, 100);
+    check(m != NULL);
+    check(filled(m, 'c', 100));
+
+    m = jc_pool_realloc(pool, m, 100, 300);
+    check(m != NULL);
+    check(filled(m, 'c', 100));
+
+    jc_pool_destroy(pool);
+}
+
+static char  cleaned[8];
+static int   ncleaned;
+
+static void cleanup(void *data)
+{
+    cleaned[ncleaned++] = *(char *)data;
+}
+
+/* cleanups run at destroy, the last added first */
+static void test_cleanup(void)
+{
+    int                 i;
+    jc_pool_t          *pool;
+    jc_pool_cleanup_t  *c;
+    static char         names[] = "abc";
+
+    pool = jc_pool_create(1024);
+    check(pool != NULL);
+
+    for (i = 0; i != 3; ++i) {
+        c = jc_pool_cleanup_add(pool);
+        check(c != NULL);
+        c->handler = cleanup;
+        c->data = &names[i];
+    }
+    /* one without handler is skipped */
+    check(jc_pool_cleanup_add(pool) != NULL);
+
+    check(ncleaned == 0);
+    jc_pool_destroy(pool);
+    check(ncleaned == 3 && memcmp(cleaned, "cba", 3) == 0);
+}
+
+/* a reset pool runs its cleanups and hands out the same memory again */
+static void test_reset(void)
+{
+    int                 i;
+    char               *first[64], *m;
+    jc_pool_t          *pool;
+    jc_pool_cleanup_t  *c;
+    static char         name = 'r';
+
+    pool = jc_pool_create(1024);
+    check(pool != NULL);
+
+    /* a few blocks, a large chunk and a cleanup */
+    for (i = 0; i != 64; ++i) {
+        first[i] = jc_pool_alloc(pool, 100);
+        check(first[i] != NULL);
+    }
+    check(jc_pool_alloc(pool, 10000) != NULL);
+    c = jc_pool_cleanup_add(pool);
+    check(c != NULL);
+    c->handler = cleanup;
+    c->data = &name;
+
+    ncleaned = 0;
+    jc_pool_reset(pool);
+    check(ncleaned == 1 && cleaned[0] == 'r');
+
+    for (i = 0; i != 64; ++i) {
+        m = jc_pool_alloc(pool, 100);
+        check(m == first[i]);
+        memset(m, 'x', 100);
+    }
+
+    /* nothing left to clean */
+    jc_pool_reset(pool);
+    jc_pool_destroy(pool);
+    check(ncleaned == 1);
+}
+
+/* freed chunks serve later allocations of their size or less */
+static void test_free(void)
+{
+    char       *a, *b, *m;
+    jc_pool_t  *pool;
+
+    pool = jc_pool_create(4096);
+    check(pool != NULL);
+
+    a = jc_pool_alloc(pool, 64);
+    b = jc_pool_alloc(pool, 200);
+    check(a != NULL && b != NULL);
+
+    jc_pool_free(pool, a, 64);
+    check(jc_pool_alloc(pool, 100) != a);       /* too big for it */
+    check(jc_pool_alloc(pool, 64) == a);
+    check(jc_pool_alloc(pool, 64) != a);        /* taken */
+
+    /* a chunk of a bigger class serves a small size */
+    jc_pool_free(pool, b, 200);
+    check(jc_pool_alloc(pool, 24) == b);
+
+    /* the last chunk of a block is taken back whole */
+    m = jc_pool_alloc(pool, 100);
+    jc_pool_free(pool, m, 100);
+    check(jc_pool_alloc(pool, 300) == m);
+
+    /* too small to hold the link, ignored */
+    jc_pool_free(pool, jc_pool_alloc(pool, 1), 1);
+
+    /* large chunks go back to the allocator, their entry is reused */
+    m = jc_pool_alloc(pool, 10000);
+    check(m != NULL);
+    memset(m, 'l', 10000);
+    jc_pool_free(pool, m, 10000);
+    m = jc_pool_alloc(pool, 20000);
+    check(m != NULL);
+    memset(m, 'l', 20000);
+
+    /* a reset forgets what was freed */
+    a = jc_pool_alloc(pool, 32);
+    jc_pool_free(pool, a, 32);
+    jc_pool_reset(pool);
+    m = jc_pool_alloc(pool, 32);
+    check(m != NULL);
+    memset(m, 'r', 32);
+
+    jc_pool_destroy(pool);
+}
+
+int main(void)
+{
+    test_in_place();
+    test_grow_past_max();
+    test_shrink_below_max();
+    test_cleanup();
+    test_reset();
+    test_free();
+
+    printf("test_alloc: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
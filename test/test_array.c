@@ -0,0 +1,330 @@
+#include "jc_type.h"
+#include "jc_reduce.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+/* the kernels against plain loops, at every length and alignment */
+static void test_reduce(void)
+{
+    size_t    n, off, i;
+    double    d[136], sum, min, max;
+    int64_t   x[136], isum, imin, imax;
+
+    srand(19);
+    for (i = 0; i != 136; ++i) {
+        /* small integers, so that any order of the sum is exact */
+        d[i] = (double)(rand() % 2001 - 1000) / 4;
+        x[i] = ((int64_t)rand() << 20) - ((int64_t)rand() << 20);
+    }
+
+    for (off = 0; off != 8; ++off) {
+        for (n = 1; off + n <= 136; ++n) {
+            sum = 0;
+            isum = 0;
+            min = max = d[off];
+            imin = imax = x[off];
+            for (i = off; i != off + n; ++i) {
+                sum += d[i];
+                isum += x[i];
+                min = d[i] < min ? d[i] : min;
+                max = d[i] > max ? d[i] : max;
+                imin = x[i] < imin ? x[i] : imin;
+                imax = x[i] > imax ? x[i] : imax;
+            }
+            check(jc_sum_f64(d + off, n) == sum);
+            check(jc_min_f64(d + off, n) == min);
+            check(jc_max_f64(d + off, n) == max);
+            check(jc_sum_i64(x + off, n) == isum);
+            check(jc_min_i64(x + off, n) == imin);
+            check(jc_max_i64(x + off, n) == imax);
+        }
+    }
+    check(jc_sum_f64(d, 0) == 0);
+    check(jc_sum_i64(x, 0) == 0);
+}
+
+/* the array at key of js, NULL if none */
+static jc_array_t *array(jc_json_t *js, const char *key)
+{
+    jc_val_t  *v;
+
+    if ((v = jc_json_find(js, key)) == NULL || jc_val_type(v) != JC_ARRAY) {
+        return NULL;
+    }
+    return jc_val_array(v);
+}
+
+static void test_packed(void)
+{
+    double       r;
+    jc_json_t   *js;
+    jc_array_t  *a;
+
+    js = jc_json_parse("{\"i\":[1,-2,3,4000000000],\"d\":[0.5,-1.5,2],"
+            "\"e\":[],\"s\":[\"x\",\"y\"],\"b\":[9007199254740993,0.5]}");
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+
+    a = array(js, "i");
+    check(a != NULL && jc_array_data_i64(a) != NULL);
+    check(jc_array_data_f64(a) == NULL);
+    check(jc_array_data_i64(a)[3] == 4000000000LL);
+    check(jc_val_type(jc_array_get(a, 1)) == JC_INT);
+    check(jc_val_int(jc_array_get(a, 1)) == -2);
+    check(jc_array_sum(a, &r) == 0 && r == 4000000002.0);
+    check(jc_array_min(a, &r) == 0 && r == -2);
+    check(jc_array_max(a, &r) == 0 && r == 4000000000.0);
+    check(jc_array_mean(a, &r) == 0 && r == 1000000000.5);
+
+    a = array(js, "d");
+    check(a != NULL && jc_array_data_f64(a) != NULL);
+    check(jc_array_data_i64(a) == NULL);
+    check(jc_array_data_f64(a)[1] == -1.5);
+    check(jc_val_type(jc_array_get(a, 0)) == JC_NUM);
+    check(jc_val_type(jc_array_get(a, 2)) == JC_INT);
+    check(jc_val_int(jc_array_get(a, 2)) == 2);
+    check(jc_array_sum(a, &r) == 0 && r == 1);
+    check(jc_array_min(a, &r) == 0 && r == -1.5);
+    check(jc_array_max(a, &r) == 0 && r == 2);
+
+    /* nothing to take a min of */
+    a = array(js, "e");
+    check(a != NULL);
+    check(jc_array_sum(a, &r) == 0 && r == 0);
+    check(jc_array_min(a, &r) == -1);
+    check(jc_array_mean(a, &r) == -1);
+
+    a = array(js, "s");
+    check(a != NULL && jc_array_data_f64(a) == NULL
+            && jc_array_data_i64(a) == NULL);
+    check(jc_array_sum(a, &r) == -1);
+
+    /* an integer which is not exact in a double keeps the array unpacked */
+    a = array(js, "b");
+    check(a != NULL && jc_array_data_f64(a) == NULL
+            && jc_array_data_i64(a) == NULL);
+    check(jc_val_int(jc_array_get(a, 0)) == 9007199254740993LL);
+    check(jc_array_sum(a, &r) == 0
+            && r >= 9007199254740992.0 && r <= 9007199254740994.0);
+
+    check(strcmp(jc_json_str(js), "{\"b\":[9007199254740993,0.5],"
+                "\"d\":[0.5,-1.5,2],\"e\":[],\"i\":[1,-2,3,4000000000],"
+                "\"s\":[\"x\",\"y\"]}") == 0);
+    jc_json_destroy(js);
+}
+
+/* values added to a packed array */
+static void test_append(void)
+{
+    int          i;
+    double       r;
+    jc_json_t   *js;
+    jc_array_t  *a;
+
+    js = jc_json_create();
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+    for (i = 0; i != 1000; ++i) {
+        check(jc_json_add_int(js, "n", i) == 0);
+    }
+    a = array(js, "n");
+    check(a != NULL && jc_array_size(a) == 1000);
+    check(jc_array_data_i64(a) != NULL && jc_array_data_i64(a)[999] == 999);
+    check(jc_array_sum(a, &r) == 0 && r == 499500);
+    check(jc_array_mean(a, &r) == 0 && r == 499.5);
+
+    /* a double turns the integers into doubles */
+    check(jc_json_add_num(js, "n", 0.25) == 0);
+    a = array(js, "n");
+    check(jc_array_data_i64(a) == NULL && jc_array_data_f64(a) != NULL);
+    check(jc_array_data_f64(a)[999] == 999 && jc_array_data_f64(a)[1000]
+            == 0.25);
+    check(jc_val_type(jc_array_get(a, 999)) == JC_INT);
+    check(jc_val_int(jc_array_get(a, 999)) == 999);
+    check(jc_val_type(jc_array_get(a, 1000)) == JC_NUM);
+    check(jc_array_sum(a, &r) == 0 && r == 499500.25);
+    check(jc_array_min(a, &r) == 0 && r == 0);
+    check(jc_array_max(a, &r) == 0 && r == 999);
+    jc_json_destroy(js);
+}
+
+/* a long array from text and its aggregates */
+static void test_long(void)
+{
+    int          i;
+    char        *json, *p;
+    double       r, d, sum;
+    jc_json_t   *js;
+    jc_array_t  *a;
+
+    json = malloc(1 << 20);
+    check(json != NULL);
+    if (json == NULL) {
+        return;
+    }
+    p = json;
+    p += sprintf(p, "{\"x\":[");
+    sum = 0;
+    for (i = 0; i != 50000; ++i) {
+        d = i % 1000 - 500 + 0.5;
+        p += sprintf(p, "%s%.1f", i ? "," : "", d);
+        sum += d;
+    }
+    p += sprintf(p, "]}");
+
+    js = jc_json_parse_n(json, p - json, NULL);
+    check(js != NULL);
+    if (js != NULL) {
+        a = array(js, "x");
+        check(a != NULL && jc_array_size(a) == 50000);
+        check(jc_array_data_f64(a) != NULL);
+        check(jc_array_sum(a, &r) == 0 && r == sum);
+        check(jc_array_min(a, &r) == 0 && r == -499.5);
+        check(jc_array_max(a, &r) == 0 && r == 499.5);
+        check(jc_val_num(jc_array_get(a, 49999)) == 499.5);
+        jc_json_destroy(js);
+    }
+    free(json);
+}
+
+/* arrays may hold values of any types */
+static void test_mixed(void)
+{
+    double       r;
+    jc_json_t   *js;
+    jc_array_t  *a;
+    const char  *json;
+
+    json = "{\"m\":[1,\"a\",null,true,{\"b\":[]},[2.5]],\"n\":[1,2.5],"
+        "\"p\":[1,2]}";
+    js = jc_json_parse(json);
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+    check(strcmp(jc_json_str(js), json) == 0);
+
+    a = array(js, "m");
+    check(a != NULL && jc_array_size(a) == 6);
+    check(jc_val_type(jc_array_get(a, 0)) == JC_INT);
+    check(jc_val_type(jc_array_get(a, 1)) == JC_STR);
+    check(jc_val_type(jc_array_get(a, 2)) == JC_NULL);
+    check(jc_val_type(jc_array_get(a, 4)) == JC_JSON);
+    check(jc_val_type(jc_array_get(a, 5)) == JC_ARRAY);
+    check(jc_array_sum(a, &r) == -1);
+    check(jc_array_max(a, &r) == -1);
+
+    /* numbers of both kinds are all numbers */
+    a = array(js, "n");
+    check(a != NULL && jc_array_sum(a, &r) == 0 && r == 3.5);
+
+    /* a packed array taking something else unpacks */
+    check(jc_json_add_str(js, "p", "x") == 0);
+    a = array(js, "p");
+    check(a != NULL && jc_array_size(a) == 3);
+    check(jc_array_data_i64(a) == NULL);
+    check(jc_val_int(jc_array_get(a, 1)) == 2);
+    check(strcmp(jc_val_str(jc_array_get(a, 2), NULL), "x") == 0);
+    check(jc_array_sum(a, &r) == -1);
+    jc_json_destroy(js);
+}
+
+/* s parses, and prints as want */
+static void check_json(const char *s, const char *want)
+{
+    jc_json_t  *js;
+
+    js = jc_json_parse(s);
+    check(js != NULL);
+    if (js == NULL) {
+        printf("    parsing %s\n", s);
+        return;
+    }
+    check(strcmp(jc_json_str(js), want) == 0);
+    if (strcmp(jc_json_str(js), want) != 0) {
+        printf("    %s printed as %s\n", s, jc_json_str(js));
+    }
+    jc_json_destroy(js);
+}
+
+/* the values of a repeated key are gathered in an array */
+static void test_repeated(void)
+{
+    check_json("{\"a\":1,\"a\":\"x\"}", "{\"a\":[1,\"x\"]}");
+    check_json("{\"a\":null,\"a\":{},\"a\":true}",
+            "{\"a\":[null,{},true]}");
+    check_json("{\"a\":[1],\"a\":\"x\"}", "{\"a\":[1,\"x\"]}");
+    check_json("{\"a\":[1],\"a\":[\"x\"]}", "{\"a\":[[1],[\"x\"]]}");
+    check_json("{\"a\":1,\"a\":2,\"a\":[3]}", "{\"a\":[[1,2],[3]]}");
+}
+
+/* integers packed with doubles are still integers, wherever they are */
+static void test_ints(void)
+{
+    int          i;
+    char         json[4096], *p;
+    double       r;
+    jc_json_t   *js;
+    jc_array_t  *a;
+
+    check_json("{\"a\":[1,2,3.5]}", "{\"a\":[1,2,3.5]}");
+    check_json("{\"a\":[1.0,-0.0,7]}", "{\"a\":[1,-0,7]}");
+
+    /* grown well past the first bits, ints turned doubles at 100 */
+    p = json;
+    p += sprintf(p, "{\"x\":[");
+    for (i = 0; i != 300; ++i) {
+        p += sprintf(p, i == 100 || (i > 100 && i % 3) ? "%s%d.5" : "%s%d",
+                i ? "," : "", i);
+    }
+    p += sprintf(p, "]}");
+
+    js = jc_json_parse(json);
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+    a = array(js, "x");
+    check(a != NULL && jc_array_data_f64(a) != NULL);
+    for (i = 0; a != NULL && i != 300; ++i) {
+        if (i < 100 || (i > 100 && i % 3 == 0)) {
+            check(jc_val_type(jc_array_get(a, i)) == JC_INT
+                    && jc_val_int(jc_array_get(a, i)) == i);
+        } else {
+            check(jc_val_type(jc_array_get(a, i)) == JC_NUM
+                    && jc_val_num(jc_array_get(a, i)) == i + 0.5);
+        }
+    }
+    check(a != NULL && jc_array_min(a, &r) == 0 && r == 0);
+    check(strcmp(jc_json_str(js), json) == 0);
+    jc_json_destroy(js);
+}
+
+int main(void)
+{
+    test_reduce();
+    test_packed();
+    test_append();
+    test_long();
+    test_mixed();
+    test_repeated();
+    test_ints();
+
+    printf("test_array: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
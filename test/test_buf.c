@@ -0,0 +1,144 @@
+#include "jc_type.h"
+#include "jc_buf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+#define check_buf(b, want) \
+    check((b)->len == strlen(want) && memcmp((b)->data, want, (b)->len) == 0)
+
+static void test_put(void)
+{
+    int       i;
+    jc_buf_t  b;
+
+    jc_buf_init(&b);
+
+    check(jc_buf_put_str(&b, "a\"b\\c/\n\t\x01\x1f\x7f\xc3\xa9", 13) == 0);
+    check_buf(&b, "\"a\\\"b\\\\c\\/\\n\\t\\u0001\\u001f\x7f\xc3\xa9\"");
+
+    jc_buf_reset(&b);
+    check(b.len == 0);
+    check(jc_buf_put_num(&b, 0.5) == 0);
+    check(jc_buf_putc(&b, ',') == 0);
+    check(jc_buf_put_int(&b, -3) == 0);
+    check_buf(&b, "0.5,-3");
+
+    /* a growable buffer grows */
+    jc_buf_reset(&b);
+    for (i = 0; i != 10000; ++i) {
+        check(jc_buf_put(&b, "0123456789", 10) == 0);
+    }
+    check(b.len == 100000 && memcmp(b.data + 99990, "0123456789", 10) == 0);
+
+    jc_buf_free(&b);
+}
+
+/* a fixed buffer never grows, it is full with what fits */
+static void test_fixed(void)
+{
+    char      mem[4];
+    jc_buf_t  b;
+
+    jc_buf_init_fixed(&b, mem, sizeof(mem));
+    check(jc_buf_put(&b, "ab", 2) == 0);
+    check(jc_buf_put_str(&b, "cd", 2) == JC_BUF_FULL);
+    check(b.len == sizeof(mem) && memcmp(mem, "ab\"c", 4) == 0);
+    check(b.data == mem);
+
+    jc_buf_reset(&b);
+    check(jc_buf_put(&b, "wxyz", 4) == 0);
+    check(jc_buf_putc(&b, '!') == JC_BUF_FULL);
+    check(memcmp(mem, "wxyz", 4) == 0);
+}
+
+/* js written in pieces of size bytes is the same as jc_json_str(js) */
+static void check_write(jc_json_t *js, size_t size)
+{
+    int          rc;
+    char        *mem, *out;
+    size_t       n, len;
+    jc_buf_t     b;
+    const char  *want;
+
+    want = jc_json_str_n(js, &len);
+    mem = malloc(size);
+    out = malloc(len + 1);
+    check(mem != NULL && out != NULL);
+    if (mem == NULL || out == NULL) {
+        free(mem);
+        free(out);
+        return;
+    }
+
+    jc_buf_init_fixed(&b, mem, size);
+    n = 0;
+    while ((rc = jc_json_write(js, &b)) == JC_BUF_FULL) {
+        check(n + b.len <= len);
+        if (n + b.len > len) {
+            break;
+        }
+        memcpy(out + n, b.data, b.len);
+        n += b.len;
+        jc_buf_drain(&b);
+    }
+    check(rc == 0 && n + b.len == len);
+    if (rc == 0 && n + b.len == len) {
+        memcpy(out + n, b.data, b.len);
+        check(memcmp(out, want, len) == 0);
+    }
+
+    free(mem);
+    free(out);
+}
+
+static void test_json_write(void)
+{
+    size_t      size, len;
+    jc_buf_t    b;
+    jc_json_t  *js;
+
+    js = jc_json_parse("{\"name\":\"a\\\"b\\u00e9\",\"n\":[1,2,3],"
+            "\"x\":-0.25,\"t\":true,\"z\":null,\"o\":{\"p\":{\"q\":[]}}}");
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+
+    /* appended to what out holds */
+    jc_buf_init(&b);
+    check(jc_buf_put(&b, "[", 1) == 0);
+    check(jc_json_write(js, &b) == 0);
+    check(jc_buf_putc(&b, ',') == 0);
+    check(jc_json_write(js, &b) == 0);
+    len = strlen(jc_json_str(js));
+    check(b.len == 2 + 2 * len);
+    check(memcmp(b.data + 1, jc_json_str(js), len) == 0);
+    check(memcmp(b.data + 2 + len, jc_json_str(js), len) == 0);
+    jc_buf_free(&b);
+
+    for (size = 1; size != 80; ++size) {
+        check_write(js, size);
+    }
+    jc_json_destroy(js);
+}
+
+int main(void)
+{
+    test_put();
+    test_fixed();
+    test_json_write();
+
+    printf("test_buf: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
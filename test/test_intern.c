@@ -0,0 +1,207 @@
+#include "jc_type.h"
+#include "jc_intern.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+static jc_key_t *get(jc_intern_t *dict, const char *key)
+{
+    return jc_intern_get(dict, key, strlen(key), jc_intern_hash(key,
+                strlen(key)));
+}
+
+static jc_key_t *find(jc_intern_t *dict, const char *key)
+{
+    return jc_intern_find(dict, key, strlen(key), jc_intern_hash(key,
+                strlen(key)));
+}
+
+static void test_dict(void)
+{
+    int           i;
+    char          key[16];
+    jc_key_t     *a, *k;
+    jc_intern_t  *dict;
+
+    dict = jc_intern_create(0);
+    check(dict != NULL);
+    if (dict == NULL) {
+        return;
+    }
+
+    check(find(dict, "a") == NULL);
+    a = get(dict, "a");
+    check(a != NULL && jc_str_size(a) == 1
+            && strcmp(jc_str_body(a), "a") == 0);
+    check(get(dict, "a") == a);
+    check(find(dict, "a") == a);
+    check(find(dict, "b") == NULL);
+
+    /* a key is its bytes, a NUL included */
+    k = jc_intern_get(dict, "a\0b", 3, jc_intern_hash("a\0b", 3));
+    check(k != NULL && k != a && jc_str_size(k) == 3);
+    check(get(dict, "") != NULL && get(dict, "") != a);
+
+    /* the table grows, keys stay where they are */
+    for (i = 0; i != 10000; ++i) {
+        snprintf(key, sizeof(key), "key%d", i);
+        check(get(dict, key) != NULL);
+    }
+    check(get(dict, "a") == a);
+    for (i = 0; i != 10000; ++i) {
+        snprintf(key, sizeof(key), "key%d", i);
+        k = find(dict, key);
+        check(k != NULL && strcmp(jc_str_body(k), key) == 0);
+    }
+    jc_intern_destroy(dict);
+}
+
+/* past max keys, new ones are not added */
+static void test_max(void)
+{
+    int           i;
+    char          key[16];
+    jc_key_t     *first;
+    jc_intern_t  *dict;
+
+    dict = jc_intern_create(10);
+    check(dict != NULL);
+    if (dict == NULL) {
+        return;
+    }
+    first = get(dict, "k0");
+    for (i = 1; i != 10; ++i) {
+        snprintf(key, sizeof(key), "k%d", i);
+        check(get(dict, key) != NULL);
+    }
+    check(get(dict, "k10") == NULL);
+    check(find(dict, "k10") == NULL);
+    check(get(dict, "k0") == first);
+    jc_intern_destroy(dict);
+}
+
+/* documents of a dictionary share their keys */
+static void test_documents(void)
+{
+    size_t        used;
+    jc_val_t     *v;
+    jc_json_t    *a, *b, *c;
+    jc_intern_t  *dict;
+    const char   *json = "{\"id\":1,\"na\\u006de\":\"x\",\"tags\":[1,2]} ";
+
+    dict = jc_intern_create(0);
+    a = jc_json_create();
+    b = jc_json_create();
+    c = jc_json_create();
+    check(dict != NULL && a != NULL && b != NULL && c != NULL);
+    if (dict == NULL || a == NULL || b == NULL || c == NULL) {
+        return;
+    }
+
+    check(jc_json_set_intern(a, dict) == 0);
+    check(jc_json_set_intern(b, dict) == 0);
+    /* the documents keep the dictionary */
+    jc_intern_destroy(dict);
+
+    check(jc_json_parse_to(a, json, strlen(json), &used) == 0);
+    check(used == strlen(json));
+    check(jc_json_parse_to(b, json, strlen(json), NULL) == 0);
+    check(jc_json_parse_to(c, json, strlen(json), NULL) == 0);
+
+    check(jc_json_get_key(a, 0) == jc_json_get_key(b, 0));
+    check(jc_json_get_key(a, 1) == jc_json_get_key(b, 1));
+    check(jc_json_get_key(a, 0) != jc_json_get_key(c, 0));
+
+    /* found by bytes and by pointer alike */
+    check((v = jc_json_find(a, "name")) != NULL
+            && strcmp(jc_val_str(v, NULL), "x") == 0);
+    check(jc_json_add_int(a, "id", 2) == 0);
+    check(jc_json_add_int(a, "new", 3) == 0);
+    check(strcmp(jc_json_str(a),
+                "{\"id\":[1,2],\"name\":\"x\",\"new\":3,\"tags\":[1,2]}")
+            == 0);
+    check(strcmp(jc_json_str(b), jc_json_str(c)) == 0);
+
+    /* only an empty document takes a dictionary, or is parsed to */
+    dict = jc_intern_create(0);
+    check(dict != NULL);
+    if (dict != NULL) {
+        check(jc_json_set_intern(c, dict) == -1);
+        jc_intern_destroy(dict);
+    }
+    check(jc_json_parse_to(a, json, strlen(json), NULL) == -1);
+
+    jc_json_destroy(a);
+    jc_json_destroy(b);
+    jc_json_destroy(c);
+}
+
+#define NTHREADS  4
+#define NKEYS     5000
+
+static jc_intern_t  *shared;
+static jc_key_t     *seen[NTHREADS][NKEYS];
+
+static void *intern_worker(void *arg)
+{
+    int    i, t, n;
+    char   key[16];
+
+    t = (int)(intptr_t)arg;
+    for (n = 0; n != NKEYS; ++n) {
+        /* each thread goes through the keys from a different place */
+        i = (n + t * NKEYS / NTHREADS) % NKEYS;
+        snprintf(key, sizeof(key), "key%d", i);
+        seen[t][i] = get(shared, key);
+    }
+    return NULL;
+}
+
+/* threads adding the same keys get the same copies */
+static void test_threads(void)
+{
+    int        i, t;
+    pthread_t  tid[NTHREADS];
+
+    shared = jc_intern_create(0);
+    check(shared != NULL);
+    if (shared == NULL) {
+        return;
+    }
+    for (t = 0; t != NTHREADS; ++t) {
+        check(pthread_create(&tid[t], NULL, intern_worker,
+                    (void *)(intptr_t)t) == 0);
+    }
+    for (t = 0; t != NTHREADS; ++t) {
+        pthread_join(tid[t], NULL);
+    }
+
+    for (i = 0; i != NKEYS; ++i) {
+        check(seen[0][i] != NULL);
+        for (t = 1; t != NTHREADS; ++t) {
+            check(seen[t][i] == seen[0][i]);
+        }
+    }
+    jc_intern_destroy(shared);
+}
+
+int main(void)
+{
+    test_dict();
+    test_max();
+    test_documents();
+    test_threads();
+
+    printf("test_intern: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
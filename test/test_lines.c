@@ -0,0 +1,274 @@
+#include "jc_type.h"
+#include "jc_lines.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+#define NRECORDS  3000
+
+/* what the callback has seen, locked when out of order */
+typedef struct {
+    pthread_mutex_t   lock;
+    int               count;
+    int               stop;     /* the record which fails, 0 none */
+    int64_t           sum;      /* of the ids */
+    int               next;     /* the id expected in order, -1 if not */
+    int               wrong;    /* records out of their order or bad */
+} seen_t;
+
+static int on_record(void *ctx, jc_json_t *js)
+{
+    int        rc = 0;
+    int64_t    id;
+    seen_t    *seen = ctx;
+    jc_val_t  *v;
+
+    v = jc_json_find(js, "id");
+    id = v != NULL ? jc_val_int(v) : -1;
+
+    pthread_mutex_lock(&seen->lock);
+    if (++seen->count == seen->stop) {
+        rc = -1;
+    } else {
+        if (id < 0 || (seen->next != -1 && id != seen->next)) {
+            ++seen->wrong;
+        }
+        if (seen->next != -1) {
+            ++seen->next;
+        }
+        seen->sum += id;
+    }
+    pthread_mutex_unlock(&seen->lock);
+    return rc;
+}
+
+/* NRECORDS records of various lengths, one a line */
+static char *records(size_t *len)
+{
+    int     i, j;
+    char   *buf, *p;
+
+    if ((buf = malloc(NRECORDS * 128)) == NULL) {
+        return NULL;
+    }
+    p = buf;
+    for (i = 0; i != NRECORDS; ++i) {
+        p += sprintf(p, "{\"id\":%d,\"v\":[", i);
+        for (j = 0; j != i % 7; ++j) {
+            p += sprintf(p, "%s%d.5", j ? "," : "", j);
+        }
+        p += sprintf(p, "],\"s\":\"%.*s\"}%s", i % 13, "abcdefghijklm",
+                i % 5 ? "\n" : "\r\n\n");
+    }
+    *len = p - buf;
+    return buf;
+}
+
+static void seen_init(seen_t *seen, int ordered)
+{
+    memset(seen, 0, sizeof(*seen));
+    pthread_mutex_init(&seen->lock, NULL);
+    seen->next = ordered ? 0 : -1;
+}
+
+/* every record is handed over once, in order if asked, for any setting */
+static void test_lines(void)
+{
+    int              threads, ordered;
+    char            *buf;
+    size_t           len, used, c;
+    seen_t           seen;
+    jc_lines_conf_t  conf;
+    const size_t     chunks[] = { 0, 1, 50, 1000, 65536 };
+
+    buf = records(&len);
+    check(buf != NULL);
+    if (buf == NULL) {
+        return;
+    }
+
+    for (ordered = 0; ordered != 2; ++ordered) {
+        for (threads = 1; threads != 8; ++threads) {
+            for (c = 0; c != sizeof(chunks) / sizeof(chunks[0]); ++c) {
+                memset(&conf, 0, sizeof(conf));
+                conf.threads = threads;
+                conf.chunk = chunks[c];
+                conf.ordered = ordered;
+                conf.flags = c % 2 ? JC_JSON_VIEW : 0;
+
+                seen_init(&seen, ordered);
+                check(jc_lines_parse(buf, len, &conf, &used, on_record,
+                            &seen) == NRECORDS);
+                check(used == len);
+                check(seen.count == NRECORDS && seen.wrong == 0);
+                check(seen.sum == (int64_t)NRECORDS * (NRECORDS - 1) / 2);
+                pthread_mutex_destroy(&seen.lock);
+            }
+        }
+    }
+
+    /* the defaults */
+    seen_init(&seen, 0);
+    check(jc_lines_parse(buf, len, NULL, NULL, on_record, &seen)
+            == NRECORDS);
+    check(seen.count == NRECORDS && seen.wrong == 0);
+    pthread_mutex_destroy(&seen.lock);
+
+    seen_init(&seen, 0);
+    check(jc_lines_parse(buf, 0, NULL, &used, on_record, &seen) == 0);
+    check(used == 0 && seen.count == 0);
+    pthread_mutex_destroy(&seen.lock);
+    free(buf);
+}
+
+/* the records starting in the first n bytes of buf */
+static int before(const char *buf, size_t n)
+{
+    int          count = 0;
+    const char  *p;
+
+    for (p = buf; (p = strstr(p, "{\"id\":")) != NULL && p < buf + n; ++p) {
+        ++count;
+    }
+    return count;
+}
+
+/* used is where the first record not handled starts */
+static void test_errors(void)
+{
+    int              threads;
+    char            *buf, *bad;
+    size_t           len, used, off;
+    seen_t           seen;
+    jc_lines_conf_t  conf;
+
+    buf = records(&len);
+    check(buf != NULL);
+    if (buf == NULL) {
+        return;
+    }
+
+    /* record 2000 is broken */
+    bad = strstr(buf, "{\"id\":2000,");
+    check(bad != NULL);
+    if (bad == NULL) {
+        free(buf);
+        return;
+    }
+    off = bad - buf;
+    bad[5] = '}';
+
+    for (threads = 1; threads != 8; ++threads) {
+        memset(&conf, 0, sizeof(conf));
+        conf.threads = threads;
+        conf.chunk = 300;
+        conf.ordered = 1;
+
+        seen_init(&seen, 1);
+        check(jc_lines_parse(buf, len, &conf, &used, on_record, &seen)
+                == -1);
+        check(used == off && seen.count == 2000 && seen.wrong == 0);
+        pthread_mutex_destroy(&seen.lock);
+
+        /* out of order, used may stop short, the records before it were
+         * all handled */
+        conf.ordered = 0;
+        seen_init(&seen, 0);
+        check(jc_lines_parse(buf, len, &conf, &used, on_record, &seen)
+                == -1);
+        check(used <= off && seen.count >= before(buf, used)
+                && seen.wrong == 0);
+        pthread_mutex_destroy(&seen.lock);
+    }
+    bad[5] = ':';
+
+    /* a callback failing stops the workers */
+    for (threads = 1; threads != 8; ++threads) {
+        memset(&conf, 0, sizeof(conf));
+        conf.threads = threads;
+        conf.chunk = 300;
+        conf.ordered = 1;
+
+        seen_init(&seen, 1);
+        seen.stop = 101;
+        check(jc_lines_parse(buf, len, &conf, &used, on_record, &seen)
+                == -1);
+        check(seen.count == 101 && seen.wrong == 0);
+        bad = strstr(buf, "{\"id\":101,");
+        check(bad != NULL && used == (size_t)(bad - buf));
+        pthread_mutex_destroy(&seen.lock);
+    }
+    free(buf);
+}
+
+/* the last record needs no newline after it, but must be whole */
+static void test_tail(void)
+{
+    int              threads, ordered;
+    char            *buf, *last;
+    size_t           len, used;
+    seen_t           seen;
+    jc_lines_conf_t  conf;
+
+    buf = records(&len);
+    check(buf != NULL);
+    if (buf == NULL) {
+        return;
+    }
+    while (buf[len - 1] == '\n' || buf[len - 1] == '\r') {
+        --len;
+    }
+    last = strstr(buf, "{\"id\":2999,");
+    check(last != NULL);
+    if (last == NULL) {
+        free(buf);
+        return;
+    }
+
+    for (ordered = 0; ordered != 2; ++ordered) {
+        for (threads = 1; threads != 8; ++threads) {
+            memset(&conf, 0, sizeof(conf));
+            conf.threads = threads;
+            conf.chunk = 500;
+            conf.ordered = ordered;
+
+            seen_init(&seen, ordered);
+            check(jc_lines_parse(buf, len, &conf, &used, on_record, &seen)
+                    == NRECORDS);
+            check(used == len && seen.count == NRECORDS && seen.wrong == 0);
+            pthread_mutex_destroy(&seen.lock);
+
+            /* cut in the last record */
+            seen_init(&seen, ordered);
+            check(jc_lines_parse(buf, len - 3, &conf, &used, on_record,
+                        &seen) == -1);
+            check(used <= (size_t)(last - buf)
+                    && seen.count >= before(buf, used) && seen.wrong == 0);
+            check(!ordered || (used == (size_t)(last - buf)
+                        && seen.count == NRECORDS - 1));
+            pthread_mutex_destroy(&seen.lock);
+        }
+    }
+    free(buf);
+}
+
+int main(void)
+{
+    test_lines();
+    test_errors();
+    test_tail();
+
+    printf("test_lines: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
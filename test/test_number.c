@@ -0,0 +1,222 @@
+#include "jc_number.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+static ssize_t parse(const char *s, jc_number_t *num)
+{
+    return jc_number_parse(s, s + strlen(s), num);
+}
+
+static void check_int(const char *s, int64_t want)
+{
+    jc_number_t  num;
+
+    check(parse(s, &num) == (ssize_t)strlen(s));
+    check(num.is_int && num.i == want);
+}
+
+/* s is a double, the one strtod() reads */
+static void check_double(const char *s)
+{
+    jc_number_t  num;
+
+    check(parse(s, &num) == (ssize_t)strlen(s));
+    check(!num.is_int && num.d == strtod(s, NULL));
+}
+
+static void check_bad(const char *s)
+{
+    jc_number_t  num;
+
+    check(parse(s, &num) == -1);
+}
+
+static void test_int(void)
+{
+    jc_number_t  num;
+
+    check_int("0", 0);
+    check_int("7", 7);
+    check_int("-42", -42);
+    check_int("9223372036854775807", INT64_MAX);
+    check_int("-9223372036854775808", INT64_MIN);
+
+    /* too big for int64_t, a double then */
+    check_double("9223372036854775808");
+    check_double("-9223372036854775809");
+    check_double("123456789012345678901234567890");
+
+    /* an exponent or a fraction makes a double */
+    check_double("1e2");
+    check_double("1.0");
+
+    /* -0 keeps its sign */
+    check(parse("-0", &num) == 2 && !num.is_int && signbit(num.d));
+}
+
+static void test_double(void)
+{
+    jc_number_t  num;
+
+    check_double("0.1");
+    check_double("-0.0");
+    check_double("3.141592653589793");
+    check_double("1.7976931348623157e308");
+    check_double("2.2250738585072014e-308");
+    check_double("4.9e-324");
+    check_double("2.4703282292062327e-324");
+    check_double("0.000000000000000000000000000001234");
+    check_double("9007199254740993.0");
+    check_double("1E+10");
+    check_double("1e-10");
+    check_double("123456789012345678901234567890e-20");
+
+    check(parse("1e400", &num) == 5 && num.d == HUGE_VAL);
+    check(parse("-1e400", &num) == 6 && num.d == -HUGE_VAL);
+    check(parse("1e-400", &num) == 6 && num.d == 0);
+}
+
+/* a number stops at the first byte which cannot go on with it */
+static void test_syntax(void)
+{
+    jc_number_t  num;
+
+    check(parse("12,", &num) == 2 && num.is_int && num.i == 12);
+    check(parse("1.5]", &num) == 3 && num.d == 1.5);
+    check(parse("01", &num) == 1 && num.is_int && num.i == 0);
+
+    check_bad("");
+    check_bad("-");
+    check_bad("+1");
+    check_bad(".5");
+    check_bad("1.");
+    check_bad("1.e5");
+    check_bad("1e");
+    check_bad("1e+");
+    check_bad("--1");
+    check_bad("x");
+}
+
+/* random doubles, printed with 17 digits, read back exactly */
+static void test_random(void)
+{
+    int          i;
+    char         buf[64];
+    double       d;
+    uint64_t     bits;
+    jc_number_t  num;
+
+    srand(5);
+    for (i = 0; i != 100000; ++i) {
+        bits = ((uint64_t)rand() << 62) ^ ((uint64_t)rand() << 31)
+            ^ (uint64_t)rand();
+        memcpy(&d, &bits, sizeof(d));
+        if (isnan(d) || isinf(d)) {
+            continue;
+        }
+        snprintf(buf, sizeof(buf), "%.17g", d);
+        if (parse(buf, &num) != (ssize_t)strlen(buf)) {
+            check(0);
+            continue;
+        }
+        check((num.is_int ? (double)num.i : num.d) == d);
+    }
+}
+
+static void check_dtoa(double d, const char *want)
+{
+    int   n;
+    char  buf[JC_NUMBER_MAXLEN];
+
+    n = jc_number_dtoa(d, buf);
+    check(n == (int)strlen(want) && memcmp(buf, want, n) == 0);
+    if (n != (int)strlen(want) || memcmp(buf, want, n) != 0) {
+        printf("    %.17g written as %.*s\n", d, n, buf);
+    }
+}
+
+static void check_itoa(int64_t i, const char *want)
+{
+    int   n;
+    char  buf[JC_NUMBER_MAXLEN];
+
+    n = jc_number_itoa(i, buf);
+    check(n == (int)strlen(want) && memcmp(buf, want, n) == 0);
+}
+
+static void test_dtoa(void)
+{
+    check_dtoa(0.0, "0");
+    check_dtoa(-0.0, "-0");
+    check_dtoa(0.1, "0.1");
+    check_dtoa(1.5, "1.5");
+    check_dtoa(100, "100");
+    check_dtoa(12345.678, "12345.678");
+    check_dtoa(0.001, "0.001");
+    check_dtoa(1e-7, "1e-7");
+    check_dtoa(-2.5e-10, "-2.5e-10");
+    check_dtoa(1e21, "1e+21");
+    check_dtoa(123456789012345678.0, "123456789012345680");
+    check_dtoa(5e-324, "5e-324");
+    check_dtoa(1.7976931348623157e308, "1.7976931348623157e+308");
+    check_dtoa(NAN, "null");
+    check_dtoa(HUGE_VAL, "null");
+    check_dtoa(-HUGE_VAL, "null");
+
+    check_itoa(0, "0");
+    check_itoa(-1, "-1");
+    check_itoa(INT64_MAX, "9223372036854775807");
+    check_itoa(INT64_MIN, "-9223372036854775808");
+}
+
+/* random doubles are written in at most 17 digits, and read back */
+static void test_dtoa_random(void)
+{
+    int          i, n;
+    char         buf[JC_NUMBER_MAXLEN];
+    double       d;
+    uint64_t     bits;
+    jc_number_t  num;
+
+    srand(6);
+    for (i = 0; i != 200000; ++i) {
+        bits = ((uint64_t)rand() << 62) ^ ((uint64_t)rand() << 31)
+            ^ (uint64_t)rand();
+        memcpy(&d, &bits, sizeof(d));
+        if (isnan(d) || isinf(d)) {
+            continue;
+        }
+        n = jc_number_dtoa(d, buf);
+        check(n > 0 && n <= JC_NUMBER_MAXLEN);
+        if (jc_number_parse(buf, buf + n, &num) != n) {
+            check(0);
+            continue;
+        }
+        check((num.is_int ? (double)num.i : num.d) == d);
+    }
+}
+
+int main(void)
+{
+    test_int();
+    test_double();
+    test_syntax();
+    test_random();
+    test_dtoa();
+    test_dtoa_random();
+
+    printf("test_number: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
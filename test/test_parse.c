@@ -0,0 +1,1205 @@
+#include "jc_type.h"
+#include "jc_alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+/* the document flags every parse of long values is tried with */
+static const int modes[] = {
+    0,
+    JC_JSON_ORDERED,
+    JC_JSON_VIEW,
+    JC_JSON_ORDERED | JC_JSON_VIEW,
+    JC_JSON_LAZY,
+    JC_JSON_ORDERED | JC_JSON_VIEW | JC_JSON_LAZY,
+};
+
+#define NMODES (sizeof(modes) / sizeof(modes[0]))
+
+/* s parses, and prints as want */
+static void check_json(const char *s, const char *want)
+{
+    jc_json_t  *js;
+
+    js = jc_json_parse(s);
+    check(js != NULL);
+    if (js == NULL) {
+        printf("    parsing %s\n", s);
+        return;
+    }
+    check(strcmp(jc_json_str(js), want) == 0);
+    jc_json_destroy(js);
+}
+
+/* s does not parse */
+static void check_bad(const char *s)
+{
+    jc_json_t  *js;
+
+    js = jc_json_parse(s);
+    check(js == NULL);
+    if (js != NULL) {
+        printf("    parsing %s\n", s);
+        jc_json_destroy(js);
+    }
+}
+
+static void test_whitespace(void)
+{
+    check_json("{}", "{}");
+    check_json(" \t\r\n{ \t\r\n} \t\r\n", "{}");
+    check_json("{ \"a\" : 1 , \"b\" :\n[ true ,\tfalse ] , \"c\" : null }",
+            "{\"a\":1,\"b\":[true,false],\"c\":null}");
+    check_json("{\"a\":{ \"b\" : { } } }", "{\"a\":{\"b\":{}}}");
+
+    check_bad("");
+    check_bad(" ");
+    check_bad("{\"a\" 1}");
+    check_bad("{\"a\":1,}");
+    check_bad("{\"a\":[1,]}");
+    check_bad("{\"a\":1");
+    check_bad("{\"a\":\"b}");
+
+    /* nothing but whitespace may follow the value */
+    check_bad("{\"a\":1}x");
+    check_bad("{} {}");
+    check_bad("01");
+    check_bad("1 2");
+    check_bad("[1]]");
+    check_bad("\"a\"\"b\"");
+}
+
+static void test_numbers_cut(void)
+{
+    check_bad("{\"a\":1.}");
+    check_bad("{\"a\":1e}");
+    check_bad("{\"a\":1e+}");
+    check_bad("{\"a\":-}");
+}
+
+/* buf is not NUL-terminated, and holds messages back to back */
+static void test_parse_n(void)
+{
+    char        *buf;
+    size_t       len, used, off;
+    jc_val_t    *v;
+    jc_json_t   *js;
+    const char  *msgs = "{\"a\":1} \n{\"b\":\"x\"}{\"c\":[]}\t";
+
+    len = strlen(msgs);
+    buf = malloc(len);
+    check(buf != NULL);
+    if (buf == NULL) {
+        return;
+    }
+    memcpy(buf, msgs, len);
+
+    js = jc_json_parse_n(buf, len, &used);
+    check(js != NULL && used == 9);
+    v = js != NULL ? jc_json_find(js, "a") : NULL;
+    check(v != NULL && jc_val_type(v) == JC_INT && jc_val_int(v) == 1);
+    jc_json_destroy(js);
+    off = used;
+
+    js = jc_json_parse_n(buf + off, len - off, &used);
+    check(js != NULL && used == 9);
+    v = js != NULL ? jc_json_find(js, "b") : NULL;
+    check(v != NULL && jc_val_type(v) == JC_STR
+            && strcmp(jc_val_str(v, NULL), "x") == 0);
+    jc_json_destroy(js);
+    off += used;
+
+    js = jc_json_parse_n(buf + off, len - off, &used);
+    check(js != NULL && off + used == len);
+    jc_json_destroy(js);
+
+    /* without used, the buffer must hold a single message */
+    check(jc_json_parse_n(buf, len, NULL) == NULL);
+    check(jc_json_parse_ex(buf, len, NULL, JC_JSON_LAZY) == NULL);
+    js = jc_json_parse_n(buf, 9, NULL);
+    check(js != NULL && jc_json_find(js, "a") != NULL);
+    jc_json_destroy(js);
+
+    /* a prefix of a number is not taken for it */
+    js = jc_json_parse_n("01", 2, &used);
+    check(js != NULL && used == 1);
+    check(js != NULL && strcmp(jc_json_str(js), "0") == 0);
+    jc_json_destroy(js);
+
+    /* a message cut by the end of the buffer */
+    check(jc_json_parse_n(buf, 5, &used) == NULL);
+    check(jc_json_parse_n(buf, 0, NULL) == NULL);
+
+    free(buf);
+}
+
+/* json parses in every mode, and key holds the string want of len bytes */
+static void check_str(const char *json, const char *key, const char *want,
+        size_t len)
+{
+    size_t       i, n;
+    jc_val_t    *v;
+    jc_json_t   *js;
+    const char  *s;
+
+    for (i = 0; i != NMODES; ++i) {
+        js = jc_json_parse_ex(json, strlen(json), NULL, modes[i]);
+        check(js != NULL);
+        if (js == NULL) {
+            continue;
+        }
+        v = jc_json_find(js, key);
+        check(v != NULL && jc_val_type(v) == JC_STR);
+        if (v != NULL && jc_val_type(v) == JC_STR) {
+            s = jc_val_str(v, &n);
+            check(n == len && memcmp(s, want, len) == 0);
+        }
+        check(jc_json_str(js) != NULL);
+        jc_json_destroy(js);
+    }
+}
+
+/* n bytes of ch appended to s */
+static char *fill(char *s, int ch, size_t n)
+{
+    memset(s, ch, n);
+    return s + n;
+}
+
+static void test_escapes(void)
+{
+    check_str("{\"k\":\"plain\"}", "k", "plain", 5);
+    check_str("{\"k\":\"\"}", "k", "", 0);
+    check_str("{\"k\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"}", "k",
+            "\"\\/\b\f\n\r\t", 8);
+    check_str("{\"k\":\"a\\u0041b\\u007a\"}", "k", "aAbz", 4);
+    check_str("{\"a\\nb\":\"v\"}", "a\nb", "v", 1);
+    check_str("{\"k\":\"\\u00e9\\u20AC\\ud83d\\ude00\"}", "k",
+            "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80", 9);
+
+    check_bad("{\"k\":\"\\q\"}");
+    check_bad("{\"k\":\"\\u12\"}");
+    check_bad("{\"k\":\"\\u12g4\"}");
+    check_bad("{\"k\":\"ab\\\"}");
+    check_bad("{\"k\":\"\\ud83d\"}");
+    check_bad("{\"k\":\"\\ude00\\ud83d\"}");
+}
+
+/*
+ * Strings with escapes are built in a chunk that grows and is then
+ * shrunk; past about 900 bytes it crosses the largest chunk a pool
+ * block serves, after an earlier value took the start of the block.
+ * */
+static void test_long_string(void)
+{
+    char   json[4096], want[4096], *p, *w;
+
+    p = json;
+    p += sprintf(p, "{\"a\":\"\",\"k\":\"");
+    p = fill(p, 'x', 200);
+    p += sprintf(p, "\\n");
+    p = fill(p, 'y', 100);
+    p += sprintf(p, "\"}");
+    *p = '\0';
+
+    w = want;
+    w = fill(w, 'x', 200);
+    *w++ = '\n';
+    w = fill(w, 'y', 100);
+    check_str(json, "k", want, w - want);
+
+    p = json;
+    p += sprintf(p, "{\"a\":\"b\",\"k\":\"");
+    p = fill(p, 'x', 950);
+    p += sprintf(p, "\\n");
+    p = fill(p, 'y', 1000);
+    p += sprintf(p, "\\n\"}");
+    *p = '\0';
+
+    w = want;
+    w = fill(w, 'x', 950);
+    *w++ = '\n';
+    w = fill(w, 'y', 1000);
+    *w++ = '\n';
+    check_str(json, "k", want, w - want);
+}
+
+/* a long key with an escape, after an earlier value */
+static void test_long_key(void)
+{
+    char   json[4096], key[2048], *p;
+
+    p = key;
+    p = fill(p, 'k', 450);
+    *p++ = '\n';
+    p = fill(p, 'k', 500);
+    *p = '\0';
+
+    p = json;
+    p += sprintf(p, "{\"a\":1,\"");
+    p = fill(p, 'k', 450);
+    p += sprintf(p, "\\n");
+    p = fill(p, 'k', 500);
+    p += sprintf(p, "\":\"v\"}");
+    *p = '\0';
+
+    check_str(json, key, "v", 1);
+}
+
+/* arrays grow past the largest chunk of a block */
+static void test_long_array(void)
+{
+    int          i;
+    size_t       m;
+    char        *json, *p;
+    jc_val_t    *v;
+    jc_json_t   *js;
+    jc_array_t  *arr;
+
+    json = malloc(65536);
+    check(json != NULL);
+    if (json == NULL) {
+        return;
+    }
+
+    p = json;
+    p += sprintf(p, "{\"a\":\"\",\"n\":[");
+    for (i = 0; i != 1000; ++i) {
+        p += sprintf(p, "%s%d", i ? "," : "", i);
+    }
+    p += sprintf(p, "],\"s\":[");
+    for (i = 0; i != 1000; ++i) {
+        p += sprintf(p, "%s\"s\\n%d\"", i ? "," : "", i);
+    }
+    p += sprintf(p, "]}");
+
+    for (m = 0; m != NMODES; ++m) {
+        js = jc_json_parse_ex(json, p - json, NULL, modes[m]);
+        check(js != NULL);
+        if (js == NULL) {
+            continue;
+        }
+
+        v = jc_json_find(js, "n");
+        arr = v != NULL ? jc_val_array(v) : NULL;
+        check(arr != NULL && jc_array_size(arr) == 1000);
+        if (arr != NULL) {
+            check(jc_val_int(jc_array_get(arr, 999)) == 999);
+        }
+
+        v = jc_json_find(js, "s");
+        arr = v != NULL ? jc_val_array(v) : NULL;
+        check(arr != NULL && jc_array_size(arr) == 1000);
+        if (arr != NULL) {
+            check(strcmp(jc_val_str(jc_array_get(arr, 999), NULL),
+                        "s\n999") == 0);
+        }
+
+        check(jc_json_str(js) != NULL);
+        jc_json_destroy(js);
+    }
+    free(json);
+}
+
+/* integers which fit in 64 bits are kept exact */
+static void test_int64(void)
+{
+    jc_val_t    *v;
+    jc_json_t   *js;
+
+    js = jc_json_parse("{\"a\":9223372036854775807,\"b\":-12,"
+            "\"c\":1.5,\"d\":18446744073709551616}");
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+    v = jc_json_find(js, "a");
+    check(v != NULL && jc_val_type(v) == JC_INT
+            && jc_val_int(v) == INT64_MAX);
+    v = jc_json_find(js, "b");
+    check(v != NULL && jc_val_type(v) == JC_INT && jc_val_int(v) == -12
+            && jc_val_num(v) == -12.0);
+    v = jc_json_find(js, "c");
+    check(v != NULL && jc_val_type(v) == JC_NUM && jc_val_num(v) == 1.5
+            && jc_val_int(v) == 1);
+    v = jc_json_find(js, "d");
+    check(v != NULL && jc_val_type(v) == JC_NUM
+            && jc_val_num(v) == 18446744073709551616.0);
+
+    check(jc_json_add_int(js, "e", INT64_MIN) == 0);
+    v = jc_json_find(js, "e");
+    check(v != NULL && jc_val_type(v) == JC_INT
+            && jc_val_int(v) == INT64_MIN);
+    check(strstr(jc_json_str(js), "\"e\":-9223372036854775808") != NULL);
+
+    check(jc_json_add_num(js, "f", 0.1) == 0);
+    check(jc_json_add_num(js, "g", 1e-7) == 0);
+    check(strstr(jc_json_str(js), "\"f\":0.1,\"g\":1e-7") != NULL);
+    jc_json_destroy(js);
+}
+
+/* s fed in two chunks split at every byte builds what jc_json_parse() does */
+static void check_feed(const char *s)
+{
+    size_t        i, len;
+    jc_json_t    *js, *whole;
+    jc_parser_t  *parser;
+
+    len = strlen(s);
+    whole = jc_json_parse(s);
+    check(whole != NULL);
+    if (whole == NULL) {
+        return;
+    }
+
+    for (i = 0; i <= len; ++i) {
+        parser = jc_parser_create();
+        check(parser != NULL);
+        if (parser == NULL) {
+            break;
+        }
+        check(jc_parser_feed(parser, s, i) == 0);
+        check(jc_parser_feed(parser, s + i, len - i) == 0);
+        js = jc_parser_finish(parser);
+        jc_parser_destroy(parser);
+
+        check(js != NULL);
+        if (js != NULL) {
+            check(strcmp(jc_json_str(js), jc_json_str(whole)) == 0);
+            jc_json_destroy(js);
+        }
+    }
+
+    /* and one byte at a time */
+    parser = jc_parser_create();
+    check(parser != NULL);
+    if (parser != NULL) {
+        for (i = 0; i != len; ++i) {
+            check(jc_parser_feed(parser, &s[i], 1) == 0);
+        }
+        js = jc_parser_finish(parser);
+        jc_parser_destroy(parser);
+        check(js != NULL);
+        if (js != NULL) {
+            check(strcmp(jc_json_str(js), jc_json_str(whole)) == 0);
+            jc_json_destroy(js);
+        }
+    }
+
+    jc_json_destroy(whole);
+}
+
+static void test_parser(void)
+{
+    jc_parser_t  *parser;
+
+    check_feed("{}");
+    check_feed(" { \"a\" : 1 , \"b\" :\n[ true ,\tfalse ] , \"c\" : null }");
+    check_feed("{\"s\":\"\\u00e9\\ud83d\\ude00\\n\",\"o\":{\"p\":{}}}");
+    check_feed("{\"n\":[-0.25,1e-7,1E+21],\"i\":[9223372036854775807,-12]}");
+
+    /* not complete */
+    parser = jc_parser_create();
+    check(parser != NULL);
+    if (parser != NULL) {
+        check(jc_parser_feed(parser, "{\"a\":[1", 7) == 0);
+        check(jc_parser_finish(parser) == NULL);
+        jc_parser_destroy(parser);
+    }
+
+    /* bad */
+    parser = jc_parser_create();
+    check(parser != NULL);
+    if (parser != NULL) {
+        check(jc_parser_feed(parser, "{\"a\":", 5) == 0);
+        check(jc_parser_feed(parser, "1,}", 3) == -1);
+        jc_parser_destroy(parser);
+    }
+
+    /* destroyed before being finished */
+    parser = jc_parser_create();
+    check(parser != NULL);
+    if (parser != NULL) {
+        check(jc_parser_feed(parser, "{\"a\":{\"b\":\"cd", 13) == 0);
+        jc_parser_destroy(parser);
+    }
+}
+
+/* nested objects belong to the document, attached ones are kept alive */
+static void test_nested(void)
+{
+    jc_val_t   *val;
+    jc_json_t  *js, *sub, *other;
+
+    js = jc_json_parse("{\"a\":{\"b\":{\"c\":[1,2]},\"d\":\"e\"}}");
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+    val = jc_json_find(js, "a");
+    check(val != NULL && jc_val_type(val) == JC_JSON);
+    sub = jc_val_json(val);
+
+    /* a no-op on a nested object */
+    jc_json_destroy(sub);
+    check(strcmp(jc_json_str(sub), "{\"b\":{\"c\":[1,2]},\"d\":\"e\"}")
+            == 0);
+
+    /* another document holds sub after js is gone */
+    other = jc_json_create();
+    check(other != NULL);
+    if (other == NULL) {
+        jc_json_destroy(js);
+        return;
+    }
+    check(jc_json_add_json(other, "x", sub) == 0);
+    check(jc_json_add_json(other, "y", other) == -1);
+    jc_json_destroy(js);
+    check(strcmp(jc_json_str(other),
+                "{\"x\":{\"b\":{\"c\":[1,2]},\"d\":\"e\"}}") == 0);
+
+    /* and an object of its own document needs no reference */
+    val = jc_json_find(jc_val_json(jc_json_find(other, "x")), "b");
+    check(val != NULL);
+    check(jc_json_add_json(other, "z", jc_val_json(val)) == 0);
+    check(strcmp(jc_json_str(other), "{\"x\":{\"b\":{\"c\":[1,2]},"
+                "\"d\":\"e\"},\"z\":{\"c\":[1,2]}}") == 0);
+    jc_json_destroy(other);
+}
+
+/* one pool serves message after message */
+static void test_parse_into(void)
+{
+    int          i;
+    char         msg[64];
+    size_t       used, len;
+    jc_val_t    *val;
+    jc_json_t   *js;
+    jc_pool_t   *pool;
+
+    pool = jc_pool_create(1024);
+    check(pool != NULL);
+    if (pool == NULL) {
+        return;
+    }
+
+    for (i = 0; i != 100; ++i) {
+        len = snprintf(msg, sizeof(msg), "{\"i\":%d,\"s\":\"m%d\"} ", i, i);
+        js = jc_json_parse_into(pool, msg, len, &used);
+        check(js != NULL && used == len);
+        if (js == NULL) {
+            continue;
+        }
+        check((val = jc_json_find(js, "i")) != NULL && jc_val_int(val) == i);
+        check(jc_json_add_bool(js, "b", 1) == 0);
+        check(strlen(jc_json_str(js)) > len);
+        /* not the owner, the pool is */
+        jc_json_destroy(js);
+        jc_pool_reset(pool);
+    }
+
+    check(jc_json_parse_into(pool, "{\"a\":", 5, NULL) == NULL);
+    jc_pool_reset(pool);
+
+    js = jc_json_create_in(pool);
+    check(js != NULL);
+    if (js != NULL) {
+        check(jc_json_add_int(js, "a", 1) == 0);
+        check(strcmp(jc_json_str(js), "{\"a\":1}") == 0);
+    }
+    jc_pool_destroy(pool);
+}
+
+/* objects past a few keys are hashed, and still print in key order */
+static void test_wide(void)
+{
+    int          i;
+    char         key[16];
+    jc_val_t    *val;
+    jc_json_t   *js;
+    jc_str_t    *k, *prev;
+
+    js = jc_json_create();
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+
+    /* added in reverse, found in any order */
+    for (i = 999; i >= 0; --i) {
+        snprintf(key, sizeof(key), "k%03d", i);
+        check(jc_json_add_int(js, key, i) == 0);
+    }
+    check(jc_json_size(js) == 1000);
+    for (i = 0; i != 1000; ++i) {
+        snprintf(key, sizeof(key), "k%03d", i);
+        check((val = jc_json_find(js, key)) != NULL && jc_val_int(val) == i);
+    }
+    check(jc_json_find(js, "k1000") == NULL);
+    check(jc_json_find(js, "k00") == NULL);
+
+    /* walked in order */
+    prev = NULL;
+    for (i = 0; i != 1000; ++i) {
+        k = jc_json_get_key(js, i);
+        check(k != NULL);
+        check(prev == NULL || strcmp(jc_str_body(prev), jc_str_body(k)) < 0);
+        check(jc_val_int(jc_json_get_val(js, i)) == i);
+        prev = k;
+    }
+    check(strncmp(jc_json_str(js), "{\"k000\":0,\"k001\":1,", 19) == 0);
+
+    /* a key added again makes an array, after the sort as before */
+    check(jc_json_add_int(js, "k500", -1) == 0);
+    check(jc_json_add_int(js, "new", 7) == 0);
+    check((val = jc_json_find(js, "k500")) != NULL
+            && jc_val_type(val) == JC_ARRAY
+            && jc_array_size(jc_val_array(val)) == 2);
+    check((val = jc_json_find(js, "new")) != NULL && jc_val_int(val) == 7);
+    check(jc_json_size(js) == 1001);
+    check(strcmp(jc_str_body(jc_json_get_key(js, 1000)), "new") == 0);
+    jc_json_destroy(js);
+
+    /* and from the parser */
+    check_json("{\"q\":1,\"p\":2,\"o\":3,\"n\":4,\"m\":5,\"l\":6,\"k\":7,"
+            "\"j\":8,\"i\":9,\"h\":10,\"g\":11,\"f\":12,\"e\":13,\"d\":14,"
+            "\"c\":15,\"b\":16,\"a\":17}",
+            "{\"a\":17,\"b\":16,\"c\":15,\"d\":14,\"e\":13,\"f\":12,"
+            "\"g\":11,\"h\":10,\"i\":9,\"j\":8,\"k\":7,\"l\":6,\"m\":5,"
+            "\"n\":4,\"o\":3,\"p\":2,\"q\":1}");
+}
+
+/* s parsed with flags prints as want */
+static void check_json_ex(const char *s, int flags, const char *want)
+{
+    jc_json_t  *js;
+
+    js = jc_json_parse_ex(s, strlen(s), NULL, flags);
+    check(js != NULL);
+    if (js == NULL) {
+        printf("    parsing %s\n", s);
+        return;
+    }
+    check(strcmp(jc_json_str(js), want) == 0);
+    if (strcmp(jc_json_str(js), want) != 0) {
+        printf("    %s printed as %s\n", s, jc_json_str(js));
+    }
+    jc_json_destroy(js);
+}
+
+static void test_ordered(void)
+{
+    int          i;
+    char         key[16], *want;
+    size_t       n;
+    jc_val_t    *val;
+    jc_json_t   *js, *sorted;
+
+    check_json_ex("{\"b\":1,\"a\":{\"z\":2,\"y\":3},\"c\":[]}",
+            JC_JSON_ORDERED, "{\"b\":1,\"a\":{\"z\":2,\"y\":3},\"c\":[]}");
+    check_json_ex("{\"b\":1,\"a\":{\"z\":2,\"y\":3},\"c\":[]}", 0,
+            "{\"a\":{\"y\":3,\"z\":2},\"b\":1,\"c\":[]}");
+    /* duplicates still merge */
+    check_json_ex("{\"b\":1,\"a\":2,\"b\":3}", JC_JSON_ORDERED,
+            "{\"b\":[1,3],\"a\":2}");
+
+    /* hashed objects keep the order too */
+    js = jc_json_create_ex(JC_JSON_ORDERED);
+    want = malloc(20 * 1000);
+    check(js != NULL && want != NULL);
+    if (js == NULL || want == NULL) {
+        jc_json_destroy(js);
+        free(want);
+        return;
+    }
+    n = sprintf(want, "{");
+    for (i = 999; i >= 0; --i) {
+        snprintf(key, sizeof(key), "k%03d", i);
+        check(jc_json_add_int(js, key, i) == 0);
+        n += sprintf(want + n, "\"%s\":%d,", key, i);
+    }
+    want[n - 1] = '}';
+    check(strcmp(jc_json_str(js), want) == 0);
+    check(strcmp(jc_str_body(jc_json_get_key(js, 0)), "k999") == 0);
+    check((val = jc_json_find(js, "k123")) != NULL && jc_val_int(val) == 123);
+    check(jc_json_add_int(js, "k123", 0) == 0);
+    check(jc_json_size(js) == 1000);
+    jc_json_destroy(js);
+    free(want);
+
+    /* an attached object keeps its own order */
+    js = jc_json_create_ex(JC_JSON_ORDERED);
+    sorted = jc_json_create();
+    check(js != NULL && sorted != NULL);
+    if (js != NULL && sorted != NULL) {
+        check(jc_json_add_int(js, "z", 1) == 0);
+        check(jc_json_add_int(js, "a", 2) == 0);
+        check(jc_json_add_json(sorted, "y", js) == 0);
+        check(jc_json_add_int(sorted, "x", 3) == 0);
+        check(strcmp(jc_json_str(sorted),
+                    "{\"x\":3,\"y\":{\"z\":1,\"a\":2}}") == 0);
+    }
+    jc_json_destroy(js);
+    jc_json_destroy(sorted);
+}
+
+/* reserved room is filled without moving */
+static void test_reserve(void)
+{
+    int          i;
+    char         key[16];
+    jc_val_t    *v;
+    jc_json_t   *js;
+    jc_array_t  *arr;
+
+    js = jc_json_parse("{\"a\":[0]}");
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+
+    check(jc_json_reserve(js, 300) == 0);
+    for (i = 0; i != 300; ++i) {
+        snprintf(key, sizeof(key), "k%d", i);
+        check(jc_json_add_int(js, key, i) == 0);
+    }
+    check(jc_json_size(js) == 301);
+    check((v = jc_json_find(js, "k299")) != NULL && jc_val_int(v) == 299);
+
+    arr = jc_val_array(jc_json_find(js, "a"));
+    check(arr != NULL);
+    check(jc_array_reserve(arr, 500) == 0);
+    check(jc_array_reserve(arr, 1) == 0);
+    for (i = 1; i != 500; ++i) {
+        check(jc_json_add_int(js, "a", i) == 0);
+    }
+    check(jc_array_size(arr) == 500);
+    check(jc_val_int(jc_array_get(arr, 499)) == 499);
+    jc_json_destroy(js);
+}
+
+/* short strings are kept in the value, longer ones apart */
+static void test_inline(void)
+{
+    int          n;
+    char         json[128], want[32], key[8];
+    size_t       len, i;
+    jc_val_t    *v;
+    jc_json_t   *js;
+    jc_array_t  *arr;
+    const char  *s;
+
+    for (n = 0; n <= JC_STR_INLINE + 2; ++n) {
+        memset(want, 'a' + n, n);
+        want[n] = '\0';
+        snprintf(json, sizeof(json), "{\"k\":\"%s\"}", want);
+        check_str(json, "k", want, n);
+
+        /* escaped and at the edge, one byte decodes to two */
+        snprintf(json, sizeof(json), "{\"k\":\"%.*s\\u00e9\"}",
+                n > 2 ? n - 2 : 0, want);
+        memcpy(want + (n > 2 ? n - 2 : 0), "\xc3\xa9", 2);
+        check_str(json, "k", want, (n > 2 ? n - 2 : 0) + 2);
+    }
+
+    /* a NUL inside is kept */
+    check_str("{\"k\":\"a\\u0000b\"}", "k", "a\0b", 3);
+
+    /* built by hand, in arrays, and grown past inline values */
+    js = jc_json_create();
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+    for (i = 0; i != 100; ++i) {
+        memset(want, 'x', i % 20);
+        want[i % 20] = '\0';
+        check(jc_json_add_str(js, "a", want) == 0);
+        snprintf(key, sizeof(key), "k%d", (int)i);
+        check(jc_json_add_str(js, key, want) == 0);
+    }
+    arr = jc_val_array(jc_json_find(js, "a"));
+    check(arr != NULL && jc_array_size(arr) == 100);
+    for (i = 0; arr != NULL && i != 100; ++i) {
+        s = jc_val_str(jc_array_get(arr, i), &len);
+        check(len == i % 20 && strlen(s) == len);
+        snprintf(key, sizeof(key), "k%d", (int)i);
+        v = jc_json_find(js, key);
+        check(v != NULL && strlen(jc_val_str(v, NULL)) == i % 20);
+    }
+    jc_json_destroy(js);
+}
+
+/* keys with a NUL in them, as few as are kept sorted and as many as are
+ * hashed, then sorted for output */
+static void test_nul_key(void)
+{
+    int          i;
+    char         json[1024], *p;
+    size_t       m, k, la, lb;
+    jc_json_t   *js;
+    const char  *a, *b, *small;
+
+    small = "{\"a\\u0000c\":1,\"a\\u0000b\":2,\"a\\u0000d\":4,"
+            "\"a\\u0000c\":3}";
+    for (m = 0; m != NMODES; ++m) {
+        js = jc_json_parse_ex(small, strlen(small), NULL, modes[m]);
+        check(js != NULL);
+        if (js == NULL) {
+            continue;
+        }
+        check(jc_json_size(js) == 3);
+        if (!(modes[m] & JC_JSON_ORDERED)) {
+            check(strcmp(jc_json_str(js), "{\"a\\u0000b\":2,"
+                        "\"a\\u0000c\":[1,3],\"a\\u0000d\":4}") == 0);
+        }
+        jc_json_destroy(js);
+    }
+
+    p = json;
+    p += sprintf(p, "{");
+    for (i = 19; i >= 0; --i) {
+        p += sprintf(p, "\"a\\u0000%c\":%d,", 'a' + i, i);
+    }
+    p += sprintf(p, "\"a\\u0000c\":0,\"a\":0}");
+
+    js = jc_json_parse_ex(json, p - json, NULL, 0);
+    check(js != NULL && jc_json_size(js) == 21);
+    for (k = 1; js != NULL && k < jc_json_size(js); ++k) {
+        a = jc_str_body(jc_json_get_key(js, k - 1));
+        la = jc_str_size(jc_json_get_key(js, k - 1));
+        b = jc_str_body(jc_json_get_key(js, k));
+        lb = jc_str_size(jc_json_get_key(js, k));
+        i = memcmp(a, b, la < lb ? la : lb);
+        check(i < 0 || (i == 0 && la < lb));
+    }
+    jc_json_destroy(js);
+}
+
+/* the object at idx of the array at key of js */
+static jc_json_t *record(jc_json_t *js, const char *key, size_t idx)
+{
+    jc_val_t  *v;
+
+    if ((v = jc_json_find(js, key)) == NULL
+            || jc_val_type(v) != JC_ARRAY
+            || idx >= jc_array_size(jc_val_array(v)))
+    {
+        return NULL;
+    }
+    return jc_val_json(jc_array_get(jc_val_array(v), idx));
+}
+
+/* records with the same keys share them, and stay apart when changed */
+static void test_shapes(void)
+{
+    int          i;
+    char        *json, *p;
+    size_t       m;
+    jc_json_t   *js, *a, *b, *c;
+
+    json = malloc(65536);
+    check(json != NULL);
+    if (json == NULL) {
+        return;
+    }
+    p = json;
+    p += sprintf(p, "{\"r\":[");
+    for (i = 0; i != 100; ++i) {
+        p += sprintf(p, "%s{\"id\":%d,\"name\":\"n%d\",\"ok\":true}",
+                i ? "," : "", i, i);
+    }
+    p += sprintf(p, ",{\"id\":100,\"other\":1}],"
+            "\"s\":{\"ok\":false,\"name\":\"s\",\"id\":-1}}");
+
+    for (m = 0; m != NMODES; ++m) {
+        js = jc_json_parse_ex(json, p - json, NULL, modes[m]);
+        check(js != NULL);
+        if (js == NULL) {
+            continue;
+        }
+        a = record(js, "r", 0);
+        b = record(js, "r", 99);
+        c = record(js, "r", 100);
+        check(a != NULL && b != NULL && c != NULL);
+        if (a == NULL || b == NULL || c == NULL) {
+            jc_json_destroy(js);
+            continue;
+        }
+
+        check(jc_json_get_key(a, 0) == jc_json_get_key(b, 0));
+        check(jc_json_get_key(a, 2) == jc_json_get_key(b, 2));
+        check(jc_json_size(c) == 2);
+        check(jc_val_int(jc_json_find(b, "id")) == 99);
+        check(strcmp(jc_val_str(jc_json_find(b, "name"), NULL), "n99") == 0);
+        check(jc_json_find(c, "name") == NULL);
+        check(jc_val_int(jc_json_find(c, "other")) == 1);
+
+        /* a key added to one of them is not in the others */
+        check(jc_json_add_int(a, "extra", 7) == 0);
+        check(jc_json_size(a) == 4 && jc_json_size(b) == 3);
+        check(jc_json_find(b, "extra") == NULL);
+        check(jc_val_int(jc_json_find(a, "extra")) == 7);
+        check(jc_val_int(jc_json_find(a, "id")) == 0);
+
+        /* a value added to a key of one of them, too */
+        check(jc_json_add_int(b, "id", 1000) == 0);
+        check(jc_val_type(jc_json_find(b, "id")) == JC_ARRAY);
+        check(jc_val_type(jc_json_find(record(js, "r", 98), "id"))
+                == JC_INT);
+
+        check(strcmp(jc_json_str(b),
+                    "{\"id\":[99,1000],\"name\":\"n99\",\"ok\":true}") == 0);
+        jc_json_destroy(js);
+    }
+    free(json);
+
+    /* objects too wide to be shared still parse */
+    json = malloc(65536);
+    check(json != NULL);
+    if (json == NULL) {
+        return;
+    }
+    p = json;
+    p += sprintf(p, "{\"r\":[");
+    for (i = 0; i != 2; ++i) {
+        p += sprintf(p, "%s{", i ? "," : "");
+        for (m = 0; m != 300; ++m) {
+            p += sprintf(p, "%s\"k%d\":%d", m ? "," : "", (int)m, (int)m);
+        }
+        p += sprintf(p, "}");
+    }
+    p += sprintf(p, "]}");
+    js = jc_json_parse_n(json, p - json, NULL);
+    check(js != NULL);
+    if (js != NULL) {
+        check(record(js, "r", 1) != NULL
+                && jc_json_size(record(js, "r", 1)) == 300);
+        check(jc_val_int(jc_json_find(record(js, "r", 1), "k299")) == 299);
+        jc_json_destroy(js);
+    }
+    free(json);
+}
+
+/* long plain strings of a view point into the buffer */
+static void test_view(void)
+{
+    char         buf[256];
+    size_t       len;
+    jc_val_t    *v;
+    jc_json_t   *js;
+    const char  *s;
+
+    len = snprintf(buf, sizeof(buf), "{\"long\":\"%s\",\"short\":\"abc\","
+            "\"esc\":\"0123456789abcdef\\n\",\"arr\":[\"%s\"]} ",
+            "http://example.com/a/long/path", "another long string value");
+    js = jc_json_parse_ex(buf, len, NULL, JC_JSON_VIEW);
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+
+    v = jc_json_find(js, "long");
+    s = jc_val_str(v, &len);
+    check(s == strstr(buf, "http:") && len == 30);
+
+    v = jc_json_find(js, "short");
+    s = jc_val_str(v, &len);
+    check((s < buf || s >= buf + sizeof(buf)) && len == 3);
+    check(strcmp(s, "abc") == 0);
+
+    v = jc_json_find(js, "esc");
+    s = jc_val_str(v, &len);
+    check((s < buf || s >= buf + sizeof(buf)) && len == 17);
+    check(strcmp(s, "0123456789abcdef\n") == 0);
+
+    v = jc_array_get(jc_val_array(jc_json_find(js, "arr")), 0);
+    s = jc_val_str(v, &len);
+    check(s == strstr(buf, "another") && len == 25);
+
+    check(jc_json_add_str(js, "added", "a string added later") == 0);
+    check(strcmp(jc_json_str(js), "{\"added\":\"a string added later\","
+                "\"arr\":[\"another long string value\"],"
+                "\"esc\":\"0123456789abcdef\\n\","
+                "\"long\":\"http:\\/\\/example.com\\/a\\/long\\/path\","
+                "\"short\":\"abc\"}") == 0);
+    jc_json_destroy(js);
+}
+
+/* a lazy document reads as an eager one, whatever is reached first */
+static void test_lazy(void)
+{
+    size_t       m;
+    jc_val_t    *v;
+    jc_json_t   *js, *eager, *sub;
+    jc_array_t  *a;
+    const char  *json;
+
+    json = "{\"z\":{\"y\":[1,{\"x\":\"]}\\\"\"},[]],\"w\":{}},"
+        "\"a\":[{\"b\":2,\"b\":3},\"s\"],\"n\":1,\"a\":[4]}";
+    for (m = 0; m != NMODES; ++m) {
+        eager = jc_json_parse_ex(json, strlen(json), NULL,
+                modes[m] & ~JC_JSON_LAZY);
+        check(eager != NULL);
+
+        /* written before anything is reached */
+        js = jc_json_parse_ex(json, strlen(json), NULL,
+                modes[m] | JC_JSON_LAZY);
+        check(js != NULL);
+        if (js != NULL && eager != NULL) {
+            check(strcmp(jc_json_str(js), jc_json_str(eager)) == 0);
+        }
+        jc_json_destroy(js);
+
+        /* reached by a find, then by index */
+        js = jc_json_parse_ex(json, strlen(json), NULL,
+                modes[m] | JC_JSON_LAZY);
+        check(js != NULL);
+        if (js != NULL) {
+            v = jc_json_find(js, "z");
+            check(v != NULL && jc_val_type(v) == JC_JSON);
+            sub = jc_val_json(v);
+            v = jc_json_find(sub, "y");
+            check(v != NULL && jc_val_type(v) == JC_ARRAY);
+            a = jc_val_array(v);
+            check(jc_array_size(a) == 3);
+            v = jc_array_get(a, 1);
+            check(v != NULL && jc_val_type(v) == JC_JSON);
+            v = jc_json_find(jc_val_json(v), "x");
+            check(v != NULL && strcmp(jc_val_str(v, NULL), "]}\"") == 0);
+            check(jc_val_type(jc_json_get_val(sub, 0)) == JC_JSON
+                    || jc_val_type(jc_json_get_val(sub, 1)) == JC_JSON);
+            if (eager != NULL) {
+                check(strcmp(jc_json_str(js), jc_json_str(eager)) == 0);
+            }
+            jc_json_destroy(js);
+        }
+        jc_json_destroy(eager);
+    }
+
+    /* errors in parts not reached go unnoticed, those reached fail */
+    json = "{\"ok\":1,\"bad\":{\"a\" 1},\"arr\":[1,,2]}";
+    check(jc_json_parse(json) == NULL);
+    js = jc_json_parse_ex(json, strlen(json), NULL, JC_JSON_LAZY);
+    check(js != NULL);
+    if (js != NULL) {
+        check(jc_val_int(jc_json_find(js, "ok")) == 1);
+        check(jc_json_find(js, "bad") == NULL);
+        v = jc_json_find(js, "arr");
+        check(v == NULL || jc_array_get(jc_val_array(v), 0) == NULL);
+        jc_json_destroy(js);
+    }
+
+    /* an unclosed value is still an error */
+    check(jc_json_parse_ex("{\"a\":[1,2}", 11, NULL, JC_JSON_LAZY) == NULL);
+}
+
+/* any value may be at the top */
+static void test_top(void)
+{
+    size_t       m, used;
+    jc_val_t    *v;
+    jc_json_t   *js, *obj;
+    jc_array_t  *a;
+    const char  *json;
+
+    check_json("[]", "[]");
+    check_json(" [1,\"a\",{\"b\":[null]}] ", "[1,\"a\",{\"b\":[null]}]");
+    check_json("\"\\u00e9\"", "\"\xc3\xa9\"");
+    check_json("-2.5", "-2.5");
+    check_json("true", "true");
+    check_json("null", "null");
+    check_bad("[1,]");
+    check_bad("tru");
+    check_bad("\"a");
+
+    json = "[{\"a\":1},[2],\"x\"] ";
+    for (m = 0; m != NMODES; ++m) {
+        js = jc_json_parse_ex(json, strlen(json), &used, modes[m]);
+        check(js != NULL && used == strlen(json));
+        if (js == NULL) {
+            continue;
+        }
+        check(jc_json_size(js) == 0 && jc_json_find(js, "a") == NULL);
+        v = jc_json_value(js);
+        check(v != NULL && jc_val_type(v) == JC_ARRAY);
+        a = jc_val_array(v);
+        check(jc_array_size(a) == 3);
+        v = jc_json_find(jc_val_json(jc_array_get(a, 0)), "a");
+        check(v != NULL && jc_val_int(v) == 1);
+        check(strcmp(jc_val_str(jc_array_get(a, 2), NULL), "x") == 0);
+        check(strcmp(jc_json_str(js), "[{\"a\":1},[2],\"x\"]") == 0);
+
+        /* it takes no keys, nor can it be added to another document */
+        check(jc_json_add_int(js, "k", 1) == -1);
+        obj = jc_json_create();
+        check(obj != NULL && jc_json_add_json(obj, "k", js) == -1);
+        jc_json_destroy(obj);
+        jc_json_destroy(js);
+    }
+
+    /* an object is its own value */
+    js = jc_json_parse("{\"a\":1}");
+    check(js != NULL);
+    if (js != NULL) {
+        v = jc_json_value(js);
+        check(v != NULL && jc_val_type(v) == JC_JSON && jc_val_json(v) == js);
+        check(jc_json_add_int(js, "b", 2) == 0);
+        check(strcmp(jc_json_str(js), "{\"a\":1,\"b\":2}") == 0);
+        jc_json_destroy(js);
+    }
+
+    check_feed("[1,[2,{\"a\":\"b\"}],3.5]");
+    check_feed("\"str\"");
+    check_feed("-12");
+    check_feed("false");
+}
+
+/* the records of one call to jc_json_parse_lines() */
+typedef struct {
+    char    data[256];
+    size_t  len;
+    int     stop;   /* the record which fails, 0 none */
+    int     count;
+} lines_t;
+
+static int on_line(void *ctx, jc_json_t *js)
+{
+    lines_t     *l = ctx;
+    const char  *s;
+
+    if (++l->count == l->stop) {
+        return -1;
+    }
+    s = jc_json_str(js);
+    if (s == NULL || l->len + strlen(s) + 2 > sizeof(l->data)) {
+        return -1;
+    }
+    l->len += sprintf(l->data + l->len, "%s;", s);
+    return 0;
+}
+
+/* json hands count records over, and sets used */
+static void check_pending(jc_pool_t *pool, const char *json, ssize_t count,
+        size_t used)
+{
+    size_t   n;
+    lines_t  l;
+
+    memset(&l, 0, sizeof(l));
+    check(jc_json_parse_lines(pool, json, strlen(json), 0, &n, on_line, &l)
+            == count);
+    check(n == used && l.count == count);
+}
+
+static void test_lines(void)
+{
+    int          i;
+    size_t       used;
+    lines_t      l;
+    jc_pool_t   *pool;
+    const char  *json;
+
+    pool = jc_pool_create(256);
+    check(pool != NULL);
+    if (pool == NULL) {
+        return;
+    }
+
+    json = "{\"a\":1}\n{\"b\":[2,3]}\n\n[4] 5\t\"s\"\n{}\n";
+    memset(&l, 0, sizeof(l));
+    check(jc_json_parse_lines(pool, json, strlen(json), 0, &used, on_line,
+                &l) == 6);
+    check(used == strlen(json));
+    check(strcmp(l.data, "{\"a\":1};{\"b\":[2,3]};[4];5;\"s\";{};") == 0);
+
+    /* the same in every mode, with records which fill the pool */
+    for (i = 0; i != (int)NMODES; ++i) {
+        memset(&l, 0, sizeof(l));
+        json = "{\"k\":\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\"}\n"
+            "{\"k\":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19]}\n";
+        check(jc_json_parse_lines(pool, json, strlen(json), modes[i], NULL,
+                    on_line, &l) == 2);
+    }
+
+    memset(&l, 0, sizeof(l));
+    check(jc_json_parse_lines(pool, " \n", 2, 0, &used, on_line, &l) == 0);
+    check(used == 2 && l.count == 0);
+
+    /* a record reaching the end may go on, it is left for later */
+    check_pending(pool, "{\"a\":1}\n{}", 1, 8);
+    check_pending(pool, "{\"a\":1}\n{\"b\":[2,", 1, 8);
+    check_pending(pool, "{\"a\":1}\n\"b", 1, 8);
+    check_pending(pool, "1\n23", 1, 2);
+    check_pending(pool, "1 tr", 1, 2);
+    check_pending(pool, "[1,2", 0, 0);
+
+    /* records must be apart */
+    memset(&l, 0, sizeof(l));
+    json = "{\"a\":1}{\"b\":2}";
+    check(jc_json_parse_lines(pool, json, strlen(json), 0, &used, on_line,
+                &l) == -1);
+    check(used == 0 && l.count == 0);
+
+    /* used is where the bad record starts */
+    memset(&l, 0, sizeof(l));
+    json = "{\"a\":1}\n{\"b\":}\n{}";
+    check(jc_json_parse_lines(pool, json, strlen(json), 0, &used, on_line,
+                &l) == -1);
+    check(used == 8 && l.count == 1);
+
+    /* even at the end */
+    memset(&l, 0, sizeof(l));
+    json = "{\"a\":1}\n{\"b\" 2";
+    check(jc_json_parse_lines(pool, json, strlen(json), 0, &used, on_line,
+                &l) == -1);
+    check(used == 8 && l.count == 1);
+
+    /* and past the record which made each fail */
+    memset(&l, 0, sizeof(l));
+    l.stop = 2;
+    json = "1\n2\n3";
+    check(jc_json_parse_lines(pool, json, strlen(json), 0, &used, on_line,
+                &l) == -1);
+    check(used == 4 && l.count == 2);
+
+    jc_pool_destroy(pool);
+}
+
+int main(void)
+{
+    test_whitespace();
+    test_numbers_cut();
+    test_parse_n();
+    test_escapes();
+    test_long_string();
+    test_long_key();
+    test_long_array();
+    test_int64();
+    test_parser();
+    test_nested();
+    test_parse_into();
+    test_wide();
+    test_ordered();
+    test_reserve();
+    test_inline();
+    test_nul_key();
+    test_shapes();
+    test_view();
+    test_lazy();
+    test_top();
+    test_lines();
+
+    printf("test_parse: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
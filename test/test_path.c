@@ -0,0 +1,183 @@
+#include "jc_type.h"
+#include "jc_path.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+#define NPATHS(paths)  (sizeof(paths) / sizeof(paths[0]))
+
+/* json parsed through paths prints as want, or does not parse if NULL */
+static void check_path(const char *const *paths, size_t n, const char *json,
+        const char *want)
+{
+    size_t       used;
+    jc_path_t   *path;
+    jc_json_t   *js;
+    const char  *got;
+
+    path = jc_path_create(paths, n);
+    check(path != NULL);
+    if (path == NULL) {
+        return;
+    }
+    js = jc_json_parse_path(json, strlen(json), &used, path);
+    got = js != NULL ? jc_json_str(js) : NULL;
+    if (want == NULL) {
+        check(got == NULL);
+    } else {
+        check(got != NULL && strcmp(got, want) == 0 && used == strlen(json));
+    }
+    if (want == NULL ? got != NULL : got == NULL || strcmp(got, want) != 0) {
+        printf("    %s gave %s\n", json, got != NULL ? got : "NULL");
+    }
+    jc_json_destroy(js);
+    jc_path_destroy(path);
+}
+
+static void test_paths(void)
+{
+    const char  *event[] = { "user.id", "items[*].sku", "meta.ts" };
+    const char  *whole[] = { "user", "user.id" };
+    const char  *kinds[] = { "a.b", "c[*]" };
+    const char  *nested[] = { "m[*][*].v" };
+    const char  *ab[] = { "ab" };
+    const char  *top[] = { "[*].a" };
+
+    check_path(event, NPATHS(event),
+            "{\"user\":{\"id\":7,\"name\":\"bob\",\"x\":{\"y\":[1,2]}},"
+            "\"items\":[{\"sku\":\"a\",\"q\":1},{\"q\":2},"
+            "{\"sku\":\"b\\\"}\"},3,[4]],"
+            "\"meta\":{\"ts\":12.5,\"h\":\"\\\\\"},\"big\":[[[{}]]],"
+            "\"s\":\"zz\\u00e9\"} ",
+            "{\"items\":[{\"sku\":\"a\"},{},{\"sku\":\"b\\\"}\"}],"
+            "\"meta\":{\"ts\":12.5},\"user\":{\"id\":7}}");
+
+    /* a path to a value keeps all of it */
+    check_path(whole, NPATHS(whole), "{\"user\":{\"id\":7,\"n\":[1]},\"o\":1}",
+            "{\"user\":{\"id\":7,\"n\":[1]}}");
+
+    /* a value of another kind than the path expects is dropped */
+    check_path(kinds, NPATHS(kinds), "{\"a\":5,\"c\":{\"x\":1}}", "{}");
+    check_path(kinds, NPATHS(kinds),
+            "{\"a\":{\"b\":null},\"c\":[1,{\"z\":[]},\"s\"]}",
+            "{\"a\":{\"b\":null},\"c\":[1,{\"z\":[]},\"s\"]}");
+
+    check_path(nested, NPATHS(nested),
+            "{\"m\":[[{\"v\":1,\"w\":2}],[3,{\"v\":[5]}]]}",
+            "{\"m\":[[{\"v\":1}],[{\"v\":[5]}]]}");
+
+    /* keys are matched decoded, repeated ones gathered */
+    check_path(ab, NPATHS(ab), "{\"a\\u0062\":1,\"ac\":2}", "{\"ab\":1}");
+    check_path(ab, NPATHS(ab), "{\"ab\":1,\"x\":0,\"ab\":[2]}",
+            "{\"ab\":[1,[2]]}");
+
+    /* the elements of an array at the top */
+    check_path(top, NPATHS(top), "[{\"a\":1,\"b\":2},3,{\"b\":4}]",
+            "[{\"a\":1},{}]");
+
+    /* errors in kept and in skipped values */
+    check_path(ab, NPATHS(ab), "{\"ab\":tru}", NULL);
+    check_path(ab, NPATHS(ab), "{\"x\":tru}", NULL);
+    check_path(ab, NPATHS(ab), "{\"x\":\"abc", NULL);
+    check_path(ab, NPATHS(ab), "{\"x\":[1,2]", NULL);
+    check_path(ab, NPATHS(ab), "{\"x\" 1}", NULL);
+}
+
+/* records of a projected array share their keys */
+static void test_records(void)
+{
+    int          i;
+    char         json[8192], *p;
+    jc_val_t    *v;
+    jc_path_t   *path;
+    jc_json_t   *js, *a, *b;
+    jc_array_t  *arr;
+    const char  *paths[] = { "r[*].id", "r[*].tag" };
+
+    p = json;
+    p += sprintf(p, "{\"r\":[");
+    for (i = 0; i != 50; ++i) {
+        p += sprintf(p, "%s{\"id\":%d,\"skip\":{\"deep\":[%d]},\"tag\":\"t\"}",
+                i ? "," : "", i, i);
+    }
+    p += sprintf(p, "]}");
+
+    path = jc_path_create(paths, NPATHS(paths));
+    check(path != NULL);
+    if (path == NULL) {
+        return;
+    }
+    js = jc_json_parse_path(json, p - json, NULL, path);
+    check(js != NULL);
+    if (js != NULL) {
+        v = jc_json_find(js, "r");
+        arr = v != NULL ? jc_val_array(v) : NULL;
+        check(arr != NULL && jc_array_size(arr) == 50);
+        if (arr != NULL) {
+            a = jc_val_json(jc_array_get(arr, 0));
+            b = jc_val_json(jc_array_get(arr, 49));
+            check(jc_json_size(a) == 2 && jc_json_size(b) == 2);
+            check(jc_json_get_key(a, 0) == jc_json_get_key(b, 0));
+            check(jc_val_int(jc_json_find(b, "id")) == 49);
+            check(jc_json_find(b, "skip") == NULL);
+        }
+        jc_json_destroy(js);
+    }
+    jc_path_destroy(path);
+}
+
+static void test_create(void)
+{
+    size_t       i;
+    jc_path_t   *path;
+    jc_json_t   *js;
+    const char  *bad[] = { "", "a..b", "a.", ".a", "a[1]", "a[*", "a.[*]",
+                           "a[*]b" };
+    const char  *good[] = { "[*].a", "a[*][*]", "a.b.c", "a" };
+
+    for (i = 0; i != NPATHS(bad); ++i) {
+        check(jc_path_create(&bad[i], 1) == NULL);
+    }
+    path = jc_path_create(good, NPATHS(good));
+    check(path != NULL);
+
+    /* "a" keeps its value whole, the paths under it are gone */
+    check(path != NULL && jc_path_find(path, "a", 1) != NULL
+            && jc_path_find(path, "a", 1)->all
+            && jc_path_find(path, "a", 1)->child == NULL);
+    check(path != NULL && jc_path_find(path, NULL, 0) != NULL);
+    check(path != NULL && jc_path_find(path, "b", 1) == NULL);
+    jc_path_destroy(path);
+
+    /* no paths keep nothing */
+    path = jc_path_create(good, 0);
+    check(path != NULL);
+    if (path != NULL) {
+        js = jc_json_parse_path("{\"a\":1}", 7, NULL, path);
+        check(js != NULL && strcmp(jc_json_str(js), "{}") == 0);
+        jc_json_destroy(js);
+
+        /* a skipped part is still read to the end */
+        check(jc_json_parse_path("{\"a\":1} x", 9, NULL, path) == NULL);
+        jc_path_destroy(path);
+    }
+}
+
+int main(void)
+{
+    test_paths();
+    test_records();
+    test_create();
+
+    printf("test_path: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
@@ -0,0 +1,383 @@
+#include "jc_sax.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+/* the events seen so far, as text */
+typedef struct {
+    char    data[8192];
+    size_t  len;
+    int     stop;   /* the event which fails, 0 none */
+    int     count;
+} events_t;
+
+static int record(events_t *ev, const char *fmt, const char *s, size_t n)
+{
+    int  rc;
+
+    if (++ev->count == ev->stop) {
+        return -1;
+    }
+    rc = snprintf(ev->data + ev->len, sizeof(ev->data) - ev->len, fmt,
+            (int)n, s);
+    if (rc < 0 || (size_t)rc >= sizeof(ev->data) - ev->len) {
+        return -1;
+    }
+    ev->len += rc;
+    return 0;
+}
+
+static int on_start_object(void *ctx)
+{
+    return record(ctx, "{%.*s", "", 0);
+}
+
+static int on_end_object(void *ctx)
+{
+    return record(ctx, "}%.*s", "", 0);
+}
+
+static int on_start_array(void *ctx)
+{
+    return record(ctx, "[%.*s", "", 0);
+}
+
+static int on_end_array(void *ctx)
+{
+    return record(ctx, "]%.*s", "", 0);
+}
+
+static int on_key(void *ctx, const char *key, size_t len)
+{
+    return record(ctx, "K%.*s:", key, len);
+}
+
+static int on_string(void *ctx, const char *s, size_t len)
+{
+    return record(ctx, "S%.*s,", s, len);
+}
+
+static int on_number(void *ctx, double n)
+{
+    char  f[32];
+
+    snprintf(f, sizeof(f), "%g", n);
+    return record(ctx, "D%.*s,", f, strlen(f));
+}
+
+static int on_integer(void *ctx, int64_t i)
+{
+    char  f[32];
+
+    snprintf(f, sizeof(f), "%lld", (long long)i);
+    return record(ctx, "I%.*s,", f, strlen(f));
+}
+
+static int on_boolean(void *ctx, int b)
+{
+    return record(ctx, "B%.*s,", b ? "1" : "0", 1);
+}
+
+static int on_null(void *ctx)
+{
+    return record(ctx, "N%.*s,", "", 0);
+}
+
+static const jc_sax_t sax = {
+    on_start_object, on_end_object, on_start_array, on_end_array,
+    on_key, on_string, on_number, on_integer, on_boolean, on_null
+};
+
+/* json is read whole, with the events want */
+static void check_events(const char *json, const char *want)
+{
+    events_t  ev;
+
+    memset(&ev, 0, sizeof(ev));
+    check(jc_sax_parse(json, strlen(json), &sax, &ev)
+            == (ssize_t)strlen(json));
+    check(ev.len == strlen(want) && memcmp(ev.data, want, ev.len) == 0);
+    if (ev.len != strlen(want) || memcmp(ev.data, want, ev.len) != 0) {
+        printf("    %s gave %.*s\n", json, (int)ev.len, ev.data);
+    }
+}
+
+static void check_bad(const char *json)
+{
+    events_t  ev;
+
+    memset(&ev, 0, sizeof(ev));
+    check(jc_sax_parse(json, strlen(json), &sax, &ev) == -1);
+}
+
+static void test_events(void)
+{
+    check_events("{}", "{}");
+    check_events(" {\"a\" : [1, 2.5, \"x\\ny\", true,false,null, {}, [[]]]"
+            " , \"b\":{\"c\":-3}}\n",
+            "{Ka:[I1,D2.5,Sx\ny,B1,B0,N,{}[[]]]Kb:{Kc:I-3,}}");
+    check_events("{\"\\u00e9\":\"\\ud83d\\ude00\"}",
+            "{K\xc3\xa9:S\xf0\x9f\x98\x80,}");
+    check_events("{\"big\":123456789012345678901234567890}",
+            "{Kbig:D1.23457e+29,}");
+
+    /* any value at the top */
+    check_events("[1,{}]", "[I1,{}]");
+    check_events(" \"s\" ", "Ss,");
+    check_events("-7", "I-7,");
+    check_events("null\n", "N,");
+
+    check_bad("");
+    check_bad("{");
+    check_bad("{\"a\":1,}");
+    check_bad("{\"a\" 1}");
+    check_bad("{\"a\":[1,]}");
+    check_bad("{\"a\":[1 2]}");
+    check_bad("{\"a\":[1");
+    check_bad("{\"a\":tru}");
+    check_bad("{\"a\":\"\\ud83d\"}");
+    check_bad("{\"a\":1]");
+}
+
+/* what follows the value and its whitespace is not consumed */
+static void test_consumed(void)
+{
+    events_t     ev;
+    const char  *json = "{\"a\":1} \n{\"b\":2}";
+
+    memset(&ev, 0, sizeof(ev));
+    check(jc_sax_parse(json, strlen(json), &sax, &ev) == 9);
+    check(jc_sax_parse(json + 9, strlen(json) - 9, &sax, &ev) == 7);
+    check(ev.len == strlen("{Ka:I1,}{Kb:I2,}"));
+
+    /* a scalar ends where it stops */
+    check(jc_sax_parse("12 3", 4, &sax, &ev) == 3);
+    check(jc_sax_parse("3", 1, &sax, &ev) == 1);
+    check(ev.len == strlen("{Ka:I1,}{Kb:I2,}I12,I3,"));
+}
+
+/* escaped strings longer than the stack buffer */
+static void test_long_string(void)
+{
+    int        i;
+    char      *json;
+    size_t     n;
+    events_t  *ev;
+
+    json = malloc(8000);
+    ev = calloc(1, sizeof(*ev));
+    check(json != NULL && ev != NULL);
+    if (json == NULL || ev == NULL) {
+        free(json);
+        free(ev);
+        return;
+    }
+
+    n = sprintf(json, "{\"k\":\"");
+    for (i = 0; i != 400; ++i) {
+        n += sprintf(json + n, "\\n\\u00e9x");
+    }
+    n += sprintf(json + n, "\"}");
+
+    check(jc_sax_parse(json, n, &sax, ev) == (ssize_t)n);
+    check(ev->len == strlen("{Kk:S,}") + 400 * 4);
+    check(memcmp(ev->data + 5, "\n\xc3\xa9x\n\xc3\xa9x", 8) == 0);
+
+    free(json);
+    free(ev);
+}
+
+/* an object holding arrays nested depth levels in all, NULL if no memory */
+static char *nested(int depth)
+{
+    int    i;
+    char  *json;
+
+    if ((json = malloc(2 * depth + 8)) == NULL) {
+        return NULL;
+    }
+    strcpy(json, "{\"a\":");
+    for (i = 1; i != depth; ++i) {
+        json[4 + i] = '[';
+        json[3 + depth + i] = ']';
+    }
+    strcpy(json + 4 + 2 * depth - 1, "}");
+    return json;
+}
+
+static void test_depth(void)
+{
+    char      *json;
+    jc_sax_t   none;
+
+    memset(&none, 0, sizeof(none));
+
+    json = nested(JC_SAX_MAXDEPTH);
+    check(json != NULL);
+    if (json != NULL) {
+        check(jc_sax_parse(json, strlen(json), &none, NULL)
+                == (ssize_t)strlen(json));
+        free(json);
+    }
+
+    json = nested(JC_SAX_MAXDEPTH + 1);
+    check(json != NULL);
+    if (json != NULL) {
+        check(jc_sax_parse(json, strlen(json), &none, NULL) == -1);
+        free(json);
+    }
+}
+
+static void test_callbacks(void)
+{
+    int          i;
+    jc_sax_t     none;
+    events_t     ev;
+    const char  *json = "{\"a\":[1,{\"b\":2}],\"c\":\"d\"}";
+
+    /* no callbacks at all */
+    memset(&none, 0, sizeof(none));
+    check(jc_sax_parse(json, strlen(json), &none, NULL)
+            == (ssize_t)strlen(json));
+
+    /* a failing callback stops the parse there */
+    for (i = 1; i != 12; ++i) {
+        memset(&ev, 0, sizeof(ev));
+        ev.stop = i;
+        check(jc_sax_parse(json, strlen(json), &sax, &ev) == -1);
+        check(ev.count == i);
+    }
+}
+
+/* json fed as [0, split) then the rest gives the events of a whole parse */
+static void check_split(const char *json, size_t split)
+{
+    size_t           len;
+    events_t         whole, ev;
+    jc_sax_parser_t  sp;
+
+    len = strlen(json);
+    memset(&whole, 0, sizeof(whole));
+    check(jc_sax_parse(json, len, &sax, &whole) == (ssize_t)len);
+
+    memset(&ev, 0, sizeof(ev));
+    jc_sax_init(&sp, &sax, &ev);
+    check(jc_sax_feed(&sp, json, split) == 0);
+    check(jc_sax_feed(&sp, json + split, len - split) == 0);
+    check(jc_sax_finish(&sp) == 0);
+    jc_sax_free(&sp);
+
+    check(ev.len == whole.len && memcmp(ev.data, whole.data, ev.len) == 0);
+    if (ev.len != whole.len || memcmp(ev.data, whole.data, ev.len) != 0) {
+        printf("    %s split at %zu gave %.*s\n", json, split,
+                (int)ev.len, ev.data);
+    }
+}
+
+/* json fed one byte at a time */
+static void check_bytes(const char *json)
+{
+    size_t           i, len;
+    events_t         whole, ev;
+    jc_sax_parser_t  sp;
+
+    len = strlen(json);
+    memset(&whole, 0, sizeof(whole));
+    check(jc_sax_parse(json, len, &sax, &whole) == (ssize_t)len);
+
+    memset(&ev, 0, sizeof(ev));
+    jc_sax_init(&sp, &sax, &ev);
+    for (i = 0; i != len; ++i) {
+        check(jc_sax_feed(&sp, &json[i], 1) == 0);
+    }
+    check(jc_sax_finish(&sp) == 0);
+    jc_sax_free(&sp);
+
+    check(ev.len == whole.len && memcmp(ev.data, whole.data, ev.len) == 0);
+}
+
+static void test_feed(void)
+{
+    size_t       i, j;
+    const char  *docs[] = {
+        "{}",
+        " {\"a\" : [1, -2.5e-3, \"x\\ny\", true,false,null, {}, [[]]]"
+            " , \"b\":{\"c\":-3}}\n",
+        "{\"\\u00e9\\u20ac\":\"\\ud83d\\ude00 and \\\"quotes\\\"\"}",
+        "{\"n\":[0,12345678901234567890,1E+2,0.000001,-0]}",
+        "[\"a\",[true]]",
+        "-12.5e1",
+    };
+
+    for (i = 0; i != sizeof(docs) / sizeof(docs[0]); ++i) {
+        for (j = 0; j <= strlen(docs[i]); ++j) {
+            check_split(docs[i], j);
+        }
+        check_bytes(docs[i]);
+    }
+}
+
+static void test_feed_bad(void)
+{
+    events_t         ev;
+    jc_sax_parser_t  sp;
+
+    /* not complete */
+    memset(&ev, 0, sizeof(ev));
+    jc_sax_init(&sp, &sax, &ev);
+    check(jc_sax_feed(&sp, "{\"a\":[1,", 8) == 0);
+    check(jc_sax_finish(&sp) == -1);
+    jc_sax_free(&sp);
+
+    /* cut in a number */
+    memset(&ev, 0, sizeof(ev));
+    jc_sax_init(&sp, &sax, &ev);
+    check(jc_sax_feed(&sp, "{\"a\":12", 7) == 0);
+    check(jc_sax_finish(&sp) == -1);
+    jc_sax_free(&sp);
+
+    /* bad in the second chunk, and in a token spanning both */
+    memset(&ev, 0, sizeof(ev));
+    jc_sax_init(&sp, &sax, &ev);
+    check(jc_sax_feed(&sp, "{\"a\":", 5) == 0);
+    check(jc_sax_feed(&sp, "]", 1) == -1);
+    jc_sax_free(&sp);
+
+    memset(&ev, 0, sizeof(ev));
+    jc_sax_init(&sp, &sax, &ev);
+    check(jc_sax_feed(&sp, "{\"a\":tr", 7) == 0);
+    check(jc_sax_feed(&sp, "ue1}", 4) == -1);
+    jc_sax_free(&sp);
+
+    /* only whitespace may follow the object */
+    memset(&ev, 0, sizeof(ev));
+    jc_sax_init(&sp, &sax, &ev);
+    check(jc_sax_feed(&sp, "{} ", 3) == 0);
+    check(jc_sax_feed(&sp, "\n\t", 2) == 0);
+    check(jc_sax_feed(&sp, " x", 2) == -1);
+    jc_sax_free(&sp);
+}
+
+int main(void)
+{
+    test_events();
+    test_consumed();
+    test_long_string();
+    test_depth();
+    test_callbacks();
+    test_feed();
+    test_feed_bad();
+
+    printf("test_sax: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
@@ -0,0 +1,162 @@
+#include "jc_scan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+static const char *naive_ws(const char *p, const char *end)
+{
+    while (p != end
+            && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+    {
+        ++p;
+    }
+    return p;
+}
+
+static const char *naive_str(const char *p, const char *end)
+{
+    while (p != end && *p != '\"' && *p != '\\') {
+        ++p;
+    }
+    return p;
+}
+
+/* past the bracket closing the one at p, brackets only counted */
+static const char *naive_skip(const char *p, const char *end)
+{
+    int  depth = 0;
+
+    for (/* void */ ; p != end; ++p) {
+        if (*p == '{' || *p == '[') {
+            ++depth;
+        } else if (*p == '}' || *p == ']') {
+            if (--depth == 0) {
+                return p + 1;
+            }
+        } else if (*p == '\"') {
+            for (++p; p != end && *p != '\"'; ++p) {
+                if (*p == '\\' && ++p == end) {
+                    return NULL;
+                }
+            }
+            if (p == end) {
+                return NULL;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Random runs of every length up to a few vectors, scanned from every
+ * offset; each buffer is allocated at its exact size, so a read past
+ * end is caught by a memory checker.
+ * */
+static void test_random(void)
+{
+    int          round;
+    char        *buf;
+    size_t       len, i;
+    const char   set[] = " \t\n\r\"\\a{0\x80\xff";
+
+    srand(1);
+    for (round = 0; round != 2000; ++round) {
+        len = (size_t)rand() % 200;
+        buf = malloc(len + 1);
+        check(buf != NULL);
+        if (buf == NULL) {
+            return;
+        }
+        /* long runs of one class, to cross whole blocks */
+        for (i = 0; i != len; ++i) {
+            buf[i] = rand() % 8 == 0 ? set[rand() % (sizeof(set) - 1)]
+                                     : (round & 1 ? ' ' : 'x');
+        }
+        for (i = 0; i <= len; ++i) {
+            check(jc_scan_ws(buf + i, buf + len)
+                    == naive_ws(buf + i, buf + len));
+            check(jc_scan_str(buf + i, buf + len)
+                    == naive_str(buf + i, buf + len));
+        }
+        free(buf);
+    }
+}
+
+/* the value at the start of s is n bytes, or not closed if -1 */
+static void check_skip(const char *s, int n)
+{
+    const char  *end = s + strlen(s);
+
+    check(jc_scan_skip(s, end) == (n == -1 ? NULL : s + n));
+}
+
+/* values to skip, with strings, escapes and brackets in strings */
+static void test_skip(void)
+{
+    int          round;
+    char        *buf;
+    size_t       len, i;
+    const char   set[] = "{}[]{}[]\"\"\\ax";
+
+    check_skip("{}x", 2);
+    check_skip("[[],{\"a\":\"]}\"}]x", 15);
+    check_skip("{\"\\\"}\"}x", 7);
+    check_skip("{\"\\\\\"}x", 6);
+    check_skip("[\"]", -1);
+    check_skip("[[]", -1);
+
+    srand(22);
+    for (round = 0; round != 20000; ++round) {
+        len = 1 + (size_t)rand() % 300;
+        buf = malloc(len);
+        check(buf != NULL);
+        if (buf == NULL) {
+            return;
+        }
+        for (i = 0; i != len; ++i) {
+            buf[i] = rand() % 4 == 0 ? set[rand() % (sizeof(set) - 1)]
+                                     : (round & 1 ? ' ' : 'x');
+        }
+        buf[0] = round & 2 ? '{' : '[';
+        check(jc_scan_skip(buf, buf + len) == naive_skip(buf, buf + len));
+        free(buf);
+    }
+
+}
+
+static void test_long(void)
+{
+    char  buf[1000];
+
+    memset(buf, ' ', sizeof(buf));
+    check(jc_scan_ws(buf, buf + sizeof(buf)) == buf + sizeof(buf));
+    buf[999] = '1';
+    check(jc_scan_ws(buf, buf + sizeof(buf)) == buf + 999);
+
+    memset(buf, 'x', sizeof(buf));
+    check(jc_scan_str(buf, buf + sizeof(buf)) == buf + sizeof(buf));
+    buf[517] = '\\';
+    buf[800] = '\"';
+    check(jc_scan_str(buf, buf + sizeof(buf)) == buf + 517);
+    check(jc_scan_str(buf + 518, buf + sizeof(buf)) == buf + 800);
+}
+
+int main(void)
+{
+    test_random();
+    test_skip();
+    test_long();
+
+    printf("test_scan: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
@@ -0,0 +1,101 @@
+#include "jc_wchar.h"
+#include "jc_wchar.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+/* cp encodes to the n bytes want */
+static void check_utf8(uint32_t cp, const char *want, int n)
+{
+    char  out[4];
+
+    check(jc_utf8_encode(cp, out) == n);
+    check(memcmp(out, want, n) == 0);
+}
+
+static void test_utf8_encode(void)
+{
+    char  out[4];
+
+    check_utf8(0x24, "\x24", 1);
+    check_utf8(0x7f, "\x7f", 1);
+    check_utf8(0x80, "\xc2\x80", 2);
+    check_utf8(0xe9, "\xc3\xa9", 2);
+    check_utf8(0x7ff, "\xdf\xbf", 2);
+    check_utf8(0x800, "\xe0\xa0\x80", 3);
+    check_utf8(0x20ac, "\xe2\x82\xac", 3);
+    check_utf8(0xffff, "\xef\xbf\xbf", 3);
+    check_utf8(0x10000, "\xf0\x90\x80\x80", 4);
+    check_utf8(0x1f600, "\xf0\x9f\x98\x80", 4);
+    check_utf8(0x10ffff, "\xf4\x8f\xbf\xbf", 4);
+
+    /* surrogates and what is past unicode are no characters */
+    check(jc_utf8_encode(0xd800, out) == -1);
+    check(jc_utf8_encode(0xdfff, out) == -1);
+    check(jc_utf8_encode(0x110000, out) == -1);
+}
+
+/* the escape s decodes to the n bytes want, all of s consumed */
+static void check_unescape(const char *s, const char *want, int n)
+{
+    char    out[JC_UNESCAPE_MAX];
+    size_t  used;
+
+    check(jc_unescape(s, s + strlen(s), out, &used) == n);
+    check(memcmp(out, want, n) == 0 && used == strlen(s));
+}
+
+static void check_bad(const char *s)
+{
+    char    out[JC_UNESCAPE_MAX];
+    size_t  used;
+
+    check(jc_unescape(s, s + strlen(s), out, &used) == -1);
+}
+
+static void test_unescape(void)
+{
+    check_unescape("\\\"", "\"", 1);
+    check_unescape("\\\\", "\\", 1);
+    check_unescape("\\/", "/", 1);
+    check_unescape("\\b", "\b", 1);
+    check_unescape("\\f", "\f", 1);
+    check_unescape("\\n", "\n", 1);
+    check_unescape("\\r", "\r", 1);
+    check_unescape("\\t", "\t", 1);
+    check_unescape("\\u0041", "A", 1);
+    check_unescape("\\u00E9", "\xc3\xa9", 2);
+    check_unescape("\\u20ac", "\xe2\x82\xac", 3);
+    check_unescape("\\ud83d\\ude00", "\xf0\x9f\x98\x80", 4);
+    check_unescape("\\uDBFF\\uDFFF", "\xf4\x8f\xbf\xbf", 4);
+
+    check_bad("\\");
+    check_bad("\\q");
+    check_bad("\\u");
+    check_bad("\\u12");
+    check_bad("\\u12g4");
+    /* a lone or reversed surrogate */
+    check_bad("\\ud83d");
+    check_bad("\\ud83dx");
+    check_bad("\\ud83d\\u0041");
+    check_bad("\\ude00");
+    check_bad("\\ude00\\ud83d");
+}
+
+int main(void)
+{
+    test_utf8_encode();
+    test_unescape();
+
+    printf("test_wchar: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
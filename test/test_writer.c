@@ -0,0 +1,264 @@
+#include "jc_type.h"
+#include "jc_writer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int failures;
+
+#define check(cond) do {                                                  \
+    if (!(cond)) {                                                        \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+        ++failures;                                                       \
+    }                                                                     \
+} while (0)
+
+/* what the flush callback has been handed */
+typedef struct {
+    char    data[4096];
+    size_t  len;
+    int     calls;
+    int     fail;   /* the call which fails, 0 none */
+} sink_t;
+
+static int sink_flush(void *ctx, const char *data, size_t len)
+{
+    sink_t  *sink = ctx;
+
+    if (++sink->calls == sink->fail
+            || sink->len + len > sizeof(sink->data))
+    {
+        return -1;
+    }
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    return 0;
+}
+
+static const char want[] =
+    "{\"id\":-42,\"s\":\"a\\\"b\\n\",\"arr\":[0.5,true,null,{},[]],"
+    "\"f\":false}\n[]\n7";
+
+/* write want with the writer, 0 if all calls were right */
+static int write_doc(jc_writer_t *w)
+{
+    int  bad = 0;
+
+    bad |= jc_writer_begin_object(w);
+    bad |= jc_writer_key(w, "id", 2);
+    bad |= jc_writer_int(w, -42);
+    bad |= jc_writer_key(w, "s", 1);
+    bad |= jc_writer_str(w, "a\"b\n", 4);
+    bad |= jc_writer_key(w, "arr", 3);
+    bad |= jc_writer_begin_array(w);
+    bad |= jc_writer_num(w, 0.5);
+    bad |= jc_writer_bool(w, 1);
+    bad |= jc_writer_null(w);
+    bad |= jc_writer_begin_object(w);
+    bad |= jc_writer_end_object(w);
+    bad |= jc_writer_begin_array(w);
+    bad |= jc_writer_end_array(w);
+    bad |= jc_writer_end_array(w);
+    bad |= jc_writer_key(w, "f", 1);
+    bad |= jc_writer_bool(w, 0);
+    bad |= jc_writer_end_object(w);
+
+    /* more top-level values, one per line */
+    bad |= jc_writer_begin_array(w);
+    bad |= jc_writer_end_array(w);
+    bad |= jc_writer_int(w, 7);
+    return bad;
+}
+
+static void test_writer(void)
+{
+    jc_buf_t     b;
+    jc_val_t    *val;
+    jc_json_t   *js;
+    jc_writer_t  w;
+
+    jc_buf_init(&b);
+    jc_writer_init(&w, &b);
+    check(write_doc(&w) == 0);
+    check(b.len == strlen(want) && memcmp(b.data, want, b.len) == 0);
+
+    /* json4c reads what the writer writes */
+    jc_buf_reset(&b);
+    jc_writer_init(&w, &b);
+    check(jc_writer_begin_object(&w) == 0);
+    check(jc_writer_key(&w, "id", 2) == 0);
+    check(jc_writer_int(&w, -42) == 0);
+    check(jc_writer_key(&w, "s", 1) == 0);
+    check(jc_writer_str(&w, "\xc3\xa9\x01", 3) == 0);
+    check(jc_writer_end_object(&w) == 0);
+    js = jc_json_parse_n(b.data, b.len, NULL);
+    check(js != NULL);
+    if (js != NULL) {
+        check((val = jc_json_find(js, "id")) != NULL
+                && jc_val_int(val) == -42);
+        check((val = jc_json_find(js, "s")) != NULL
+                && strcmp(jc_val_str(val, NULL), "\xc3\xa9\x01") == 0);
+        jc_json_destroy(js);
+    }
+    jc_buf_free(&b);
+}
+
+/* calls out of place are rejected and write nothing */
+static void test_misuse(void)
+{
+    jc_buf_t     b;
+    jc_writer_t  w;
+
+    jc_buf_init(&b);
+    jc_writer_init(&w, &b);
+
+    check(jc_writer_key(&w, "k", 1) == -1);
+    check(jc_writer_end_object(&w) == -1);
+    check(jc_writer_end_array(&w) == -1);
+
+    check(jc_writer_begin_object(&w) == 0);
+    check(jc_writer_int(&w, 1) == -1);              /* value without key */
+    check(jc_writer_end_array(&w) == -1);           /* not an array */
+    check(jc_writer_key(&w, "k", 1) == 0);
+    check(jc_writer_key(&w, "l", 1) == -1);         /* key after key */
+    check(jc_writer_end_object(&w) == -1);          /* key without value */
+    check(jc_writer_int(&w, 1) == 0);
+    check(jc_writer_end_object(&w) == 0);
+
+    check(jc_writer_begin_array(&w) == 0);
+    check(jc_writer_key(&w, "k", 1) == -1);         /* key in an array */
+    check(jc_writer_end_object(&w) == -1);
+    check(jc_writer_end_array(&w) == 0);
+
+    check(b.len == strlen("{\"k\":1}\n[]")
+            && memcmp(b.data, "{\"k\":1}\n[]", b.len) == 0);
+    jc_buf_free(&b);
+}
+
+static void test_depth(void)
+{
+    int          i;
+    jc_buf_t     b;
+    jc_writer_t  w;
+
+    jc_buf_init(&b);
+    jc_writer_init(&w, &b);
+    for (i = 0; i != JC_WRITER_MAXDEPTH; ++i) {
+        check(jc_writer_begin_array(&w) == 0);
+    }
+    check(jc_writer_begin_array(&w) == -1);
+    check(jc_writer_begin_object(&w) == -1);
+    for (i = 0; i != JC_WRITER_MAXDEPTH; ++i) {
+        check(jc_writer_end_array(&w) == 0);
+    }
+    check(jc_writer_end_array(&w) == -1);
+    check(b.len == 2 * JC_WRITER_MAXDEPTH);
+    jc_buf_free(&b);
+}
+
+/* a flushing buffer of any size hands over all of the output */
+static void test_flush(void)
+{
+    char         mem[16];
+    size_t       size;
+    sink_t       sink;
+    jc_buf_t     b;
+    jc_writer_t  w;
+
+    for (size = 1; size <= sizeof(mem); ++size) {
+        memset(&sink, 0, sizeof(sink));
+        jc_buf_init_flush(&b, mem, size, sink_flush, &sink);
+        jc_writer_init(&w, &b);
+        check(write_doc(&w) == 0);
+        check(jc_buf_flush(&b) == 0);
+        check(b.len == 0);
+        check(sink.len == strlen(want)
+                && memcmp(sink.data, want, sink.len) == 0);
+        check(sink.calls >= (int)((sink.len + size - 1) / size));
+    }
+
+    /* a failing callback fails the write */
+    memset(&sink, 0, sizeof(sink));
+    sink.fail = 2;
+    jc_buf_init_flush(&b, mem, 4, sink_flush, &sink);
+    jc_writer_init(&w, &b);
+    check(jc_writer_str(&w, "abcdefghijklmnop", 16) == -1);
+    check(sink.len == 4 && memcmp(sink.data, "\"abc", 4) == 0);
+}
+
+/* a call failing to write leaves the writer as it was, to be retried */
+static void test_failed(void)
+{
+    char         mem[1], out[16];
+    size_t       len;
+    jc_buf_t     b;
+    jc_writer_t  w;
+
+    jc_buf_init_fixed(&b, mem, sizeof(mem));
+    jc_writer_init(&w, &b);
+    len = 0;
+
+    check(jc_writer_begin_array(&w) == 0);
+    check(jc_writer_begin_array(&w) == -1);
+    check(w.depth == 1 && w.stack[0] == 0);
+    out[len++] = mem[0];
+    jc_buf_drain(&b);
+    check(jc_writer_begin_array(&w) == 0);
+    check(w.depth == 2);
+
+    check(jc_writer_end_array(&w) == -1);
+    check(w.depth == 2);
+    out[len++] = mem[0];
+    jc_buf_drain(&b);
+    check(jc_writer_end_array(&w) == 0);
+    check(w.depth == 1);
+
+    out[len++] = mem[0];
+    jc_buf_drain(&b);
+    check(jc_writer_end_array(&w) == 0);
+    check(w.depth == 0);
+    out[len++] = mem[0];
+
+    check(len == 4 && memcmp(out, "[[]]", len) == 0);
+}
+
+/* jc_json_write never finds a flushing buffer full */
+static void test_json_write(void)
+{
+    char         mem[5];
+    sink_t       sink;
+    jc_buf_t     b;
+    jc_json_t   *js;
+    const char  *str;
+
+    js = jc_json_parse("{\"a\":[1,2,3],\"b\":\"xyz\",\"c\":{\"d\":null}}");
+    check(js != NULL);
+    if (js == NULL) {
+        return;
+    }
+
+    memset(&sink, 0, sizeof(sink));
+    jc_buf_init_flush(&b, mem, sizeof(mem), sink_flush, &sink);
+    check(jc_json_write(js, &b) == 0);
+    check(jc_json_write(js, &b) == 0);
+    check(jc_buf_flush(&b) == 0);
+
+    str = jc_json_str(js);
+    check(sink.len == 2 * strlen(str));
+    check(memcmp(sink.data, str, strlen(str)) == 0);
+    check(memcmp(sink.data + strlen(str), str, strlen(str)) == 0);
+    jc_json_destroy(js);
+}
+
+int main(void)
+{
+    test_writer();
+    test_misuse();
+    test_depth();
+    test_flush();
+    test_failed();
+    test_json_write();
+
+    printf("test_writer: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
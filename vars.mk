@@ -0,0 +1 @@
+DYLIB_SUFFIX=.so